@@ -36,6 +36,37 @@ enum {
 
 	SYS_MOUNT,
 	SYS_UMOUNT,
+
+	/* Virtual memory extensions. */
+	SYS_MADVISE,                /* Give advice about use of memory. */
+	SYS_MLOCK,                  /* Lock pages in memory. */
+	SYS_MUNLOCK,                /* Unlock pages. */
+	SYS_GETRUSAGE,              /* Report memory usage of this process. */
+	SYS_MREMAP,                 /* Resize or move an anonymous mapping. */
+	SYS_MSYNC,                  /* Write back a file mapping. */
+	SYS_FAULTSTAT,              /* Report page fault counters. */
 };
 
+/* Advice values for madvise(). */
+#define MADV_NORMAL     0       /* No special treatment. */
+#define MADV_RANDOM     1       /* Expect random page references. */
+#define MADV_SEQUENTIAL 2       /* Expect sequential page references. */
+#define MADV_WILLNEED   3       /* Will need these pages soon. */
+#define MADV_DONTNEED   4       /* Done with these pages; drop them. */
+
+/* Flags for mmap(), OR'd into its WRITABLE argument. */
+#define MAP_ANONYMOUS   0x100   /* Zero-filled memory, FD and OFFSET ignored. */
+#define MAP_POPULATE    0x200   /* Read in the whole mapping up front. */
+
+/* Kinds of page faults counted by faultstat(). */
+#define FAULTSTAT_STACK 0       /* Stack growth. */
+#define FAULTSTAT_ANON  1       /* First touch of an anonymous page. */
+#define FAULTSTAT_FILE  2       /* File page, read or shared. */
+#define FAULTSTAT_SWAP  3       /* Anonymous page brought back from swap. */
+#define FAULTSTAT_WP    4       /* Write to a copy-on-write page. */
+#define FAULTSTAT_KINDS 5
+
+/* Latency histogram buckets reported by faultstat(). */
+#define FAULTSTAT_BUCKETS 32
+
 #endif /* lib/syscall-nr.h */
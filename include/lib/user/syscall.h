@@ -4,6 +4,7 @@
 #include <stdbool.h>
 #include <debug.h>
 #include <stddef.h>
+#include <syscall-nr.h>
 
 /* Process identifier. */
 typedef int pid_t;
@@ -13,6 +14,24 @@ typedef int pid_t;
 typedef int off_t;
 #define MAP_FAILED ((void *) NULL)
 
+/* Memory usage reported by getrusage().  Page counts. */
+struct rusage {
+	long resident_anon;     /* Anonymous pages in memory. */
+	long resident_file;     /* File-backed pages in memory. */
+	long swapped;           /* Pages in swap. */
+	long minor_faults;      /* Faults served without I/O. */
+	long major_faults;      /* Faults that read swap or a file. */
+};
+
+/* Page fault counters of one kind reported by faultstat(). */
+struct faultstat {
+	unsigned long long count;       /* Faults resolved. */
+	unsigned long long cycles;      /* Total TSC cycles spent. */
+	unsigned long long max_cycles;  /* Slowest fault. */
+	/* Bucket I counts faults that took [2^I, 2^(I+1)) cycles. */
+	unsigned long long hist[FAULTSTAT_BUCKETS];
+};
+
 /* Maximum characters in a filename written by readdir(). */
 #define READDIR_MAX_LEN 14
 
@@ -41,6 +60,13 @@ int dup2(int oldfd, int newfd);
 /* Project 3 and optionally project 4. */
 void *mmap (void *addr, size_t length, int writable, int fd, off_t offset);
 void munmap (void *addr);
+int madvise (void *addr, size_t length, int advice);
+int mlock (const void *addr, size_t length);
+int munlock (const void *addr, size_t length);
+int getrusage (struct rusage *usage);
+void *mremap (void *addr, size_t old_length, size_t new_length, void *new_addr);
+int msync (void *addr, size_t length);
+int faultstat (int kind, struct faultstat *stat);
 
 /* Project 4 only. */
 bool chdir (const char *dir);
@@ -8,7 +8,8 @@
 enum palloc_flags {
 	PAL_ASSERT = 001,           /* Panic on failure. */
 	PAL_ZERO = 002,             /* Zero page contents. */
-	PAL_USER = 004              /* User page. */
+	PAL_USER = 004,             /* User page. */
+	PAL_NOWAIT = 010            /* Fail if the pool is locked. */
 };
 
 /* Maximum number of pages to put in user pool. */
@@ -17,7 +18,11 @@ extern size_t user_page_limit;
 uint64_t palloc_init (void);
 void *palloc_get_page (enum palloc_flags);
 void *palloc_get_multiple (enum palloc_flags, size_t page_cnt);
+void *palloc_get_huge_page (enum palloc_flags);
 void palloc_free_page (void *);
 void palloc_free_multiple (void *, size_t page_cnt);
+size_t palloc_user_page_cnt (void);
+size_t palloc_user_free_cnt (void);
+size_t palloc_user_page_idx (const void *page);
 
 #endif /* threads/palloc.h */
@@ -41,5 +41,10 @@
 #define PTE_U 0x4                        /* 1=user/kernel, 0=kernel only. */
 #define PTE_A 0x20                       /* 1=accessed, 0=not acccessed. */
 #define PTE_D 0x40                       /* 1=dirty, 0=not dirty (PTEs only). */
+#define PTE_PS 0x80                      /* 1=PDE maps a 2 MB page. */
+
+/* A 2 MB page, mapped by a single PDE with PTE_PS set. */
+#define HPGSIZE (1UL << PDXSHIFT)
+#define HPG_PAGE_CNT (HPGSIZE / PGSIZE)  /* 4 kB pages in a 2 MB page. */
 
 #endif /* threads/pte.h */
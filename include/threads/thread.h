@@ -130,6 +130,7 @@ struct thread {
 #ifdef VM
 	/* Table for whole virtual memory owned by thread. */
 	struct supplemental_page_table spt;
+	struct vm_rusage rusage;			/* 메모리 사용량 (frame_table_lock) */
 #endif
 
 	/* Owned by thread.c. */
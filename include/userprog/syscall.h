@@ -3,6 +3,6 @@
 
 void syscall_init(void);
 
-struct lock filesys_lock; // 파일 동기화를 위한 전역변수
+extern struct lock filesys_lock; // 파일 동기화를 위한 전역변수
 
 #endif /* userprog/syscall.h */
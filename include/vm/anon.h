@@ -4,13 +4,26 @@
 struct page;
 enum vm_type;
 
+/* swap 슬롯이 할당되지 않은 상태 */
+#define SWAP_SLOT_NONE ((uint32_t) -1)
+
+/* 한 번에 swap out / swap in 하는 최대 페이지 수 */
+#define SWAP_CLUSTER_PAGES 8
+
 struct anon_page {
      //swap out되어 할당된 슬롯 번호
      //swap out된 페이지는 요구 페이징에 의해 다시 메모리 로드 
     uint32_t slot_num;
+    //압축해서 메모리(zswap)에 보관 중이면 그 핸들, 아니면 NULL
+    void *zswap;
 };
 
 void vm_anon_init (void);
 bool anon_initializer (struct page *page, enum vm_type type, void *kva);
+bool anon_swap_copy (struct page *src, void *kva);
+void anon_discard (struct page *page);
+void anon_swap_slots_free (const uint32_t slots[], size_t cnt);
+void anon_swap_out_cluster (struct page *pages[], size_t cnt);
+void *do_mmap_anon (void *addr, size_t length, bool writable);
 
 #endif
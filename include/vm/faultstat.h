@@ -0,0 +1,34 @@
+#ifndef VM_FAULTSTAT_H
+#define VM_FAULTSTAT_H
+#include <stdint.h>
+#include <syscall-nr.h>
+
+/* Kinds of page faults resolved by vm_try_handle_fault().  The values
+   are the ones user programs pass to the faultstat system call. */
+enum fault_kind {
+	FAULT_STACK = FAULTSTAT_STACK,  /* Stack growth. */
+	FAULT_ANON = FAULTSTAT_ANON,    /* First touch of an anonymous page. */
+	FAULT_FILE = FAULTSTAT_FILE,    /* File page, read or shared. */
+	FAULT_SWAP = FAULTSTAT_SWAP,    /* Anonymous page brought back from swap. */
+	FAULT_WP = FAULTSTAT_WP,        /* Write to a copy-on-write page. */
+	FAULT_KIND_CNT = FAULTSTAT_KINDS
+};
+
+/* Latency histogram buckets.  Bucket I counts faults that took
+   [2^I, 2^(I+1)) TSC cycles, and the last bucket everything longer. */
+#define FAULT_HIST_BUCKETS FAULTSTAT_BUCKETS
+
+/* Counters of one fault kind.  Laid out like struct faultstat in
+   <syscall.h>, which the faultstat system call copies it into. */
+struct fault_stat {
+	uint64_t cnt;               /* Faults resolved. */
+	uint64_t cycles;            /* Total cycles spent. */
+	uint64_t max_cycles;        /* Slowest fault. */
+	uint64_t hist[FAULT_HIST_BUCKETS];
+};
+
+void faultstat_record (enum fault_kind, uint64_t cycles);
+void faultstat_get (enum fault_kind, struct fault_stat *);
+void faultstat_print (void);
+
+#endif /* vm/faultstat.h */
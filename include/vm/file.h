@@ -11,11 +11,17 @@ struct file_page {
 	size_t offset;
 	size_t read_bytes;
 	size_t zero_bytes;
+	int64_t dirty_since;	//writeback 데몬이 처음 dirty로 본 시각 (ticks), 아니면 -1
 };
 
+/* writeback 데몬 설정 - 커널 옵션으로 조절 */
+extern int64_t vm_writeback_expire;	/* dirty 상태로 이만큼(ticks) 지난 페이지를 쓴다. */
+extern size_t vm_writeback_batch;	/* 한 번 깨어날 때 쓰는 최대 페이지 수 */
+
 void vm_file_init (void);
 bool file_backed_initializer (struct page *page, enum vm_type type, void *kva);
 void *do_mmap(void *addr, size_t length, int writable,
 		struct file *file, off_t offset);
 void do_munmap (void *va);
+void vm_file_print_stats (void);
 #endif
@@ -0,0 +1,19 @@
+#ifndef VM_SPT_H
+#define VM_SPT_H
+#include "vm/vm.h"
+
+/* Called for each page by spt_tree_walk.  Return false to stop. */
+typedef bool spt_walk_func (struct page *page, void *aux);
+
+void spt_tree_init (struct supplemental_page_table *spt);
+struct page *spt_tree_find (struct supplemental_page_table *spt,
+		const void *va);
+bool spt_tree_insert (struct supplemental_page_table *spt, struct page *page);
+struct page *spt_tree_remove (struct supplemental_page_table *spt,
+		const void *va);
+bool spt_tree_walk (struct supplemental_page_table *spt, const void *start,
+		const void *end, spt_walk_func *func, void *aux);
+void spt_tree_destroy (struct supplemental_page_table *spt,
+		spt_walk_func *func, void *aux);
+
+#endif /* vm/spt.h */
@@ -2,8 +2,7 @@
 #define VM_VM_H
 #include <stdbool.h>
 #include "threads/palloc.h"
-
-//해시를 사용하기위한 헤더파일
+#include <list.h>
 #include <hash.h>
 
 enum vm_type {
@@ -39,12 +38,29 @@ struct thread;
 
 #define VM_TYPE(type) ((type) & 7)
 
-/* 추가한 전역 변수들 */
-struct list frame_table; //lru 방식으로 희생자 선택
-struct lock frame_table_lock;
+/* 프로세스별 메모리 사용량 (페이지 단위)
+ * 사용자 프로그램의 struct rusage (lib/user/syscall.h)와 구조가 같다. */
+struct vm_rusage {
+	long resident_anon;		/* 메모리에 있는 anon 페이지 */
+	long resident_file;		/* 메모리에 있는 파일 페이지 */
+	long swapped;			/* swap (디스크나 zswap)에 있는 페이지 */
+	long minor_faults;		/* 디스크를 읽지 않고 처리한 fault */
+	long major_faults;		/* swap이나 파일을 읽어야 했던 fault */
+};
+
+/* 추가한 전역 변수들 - vm.c에 정의 */
+extern struct lock frame_table_lock;
 
-struct list swap_table; //swap slot 사용 여부를 판단하기 위해 사용
-struct lock swap_table_lock;
+/* fault-around로 한 번에 매핑할 최대 페이지 수 */
+extern size_t vm_fault_around_pages;
+/* 프로세스 하나가 mlock으로 고정할 수 있는 최대 페이지 수 (0이면 사용자 풀의 1/8) */
+extern size_t vm_mlock_limit;
+/* true면 프로세스가 끝날 때 메모리 사용량을 출력한다. */
+extern bool vm_rusage_report;
+/* false면 2MB 페이지를 쓰지 않는다. */
+extern bool vm_huge_pages;
+/* idle 스레드가 미리 0으로 채워 둘 프레임 수 (0이면 끔) */
+extern size_t vm_prezero_pages;
 
 /* The representation of "page".
  * This is kind of "parent class", which has four "child class"es, which are
@@ -56,10 +72,13 @@ struct page {
 	struct frame *frame;   /* Back reference for frame */
 
 	/* Your implementation */
-	struct hash_elem hash_elem; /* hash table element */
+	struct list_elem share_elem; /* frame->pages element */
+	struct thread *owner;		/* 페이지를 가진 프로세스 (역매핑) */
 
 	bool writable;			/* True : 쓰기 가능 */
 	int mapped_page_count;	/* 현재 페이지에 매핑된 파일 개수 */
+	uint8_t advice;			/* madvise로 받은 접근 방식 (MADV_NORMAL 등) */
+	bool locked;			/* mlock으로 고정됨 - evict 하지 않는다. */
 
 	/* Per-type data are binded into the union.
 	 * Each function automatically detects the current union */
@@ -76,17 +95,20 @@ struct page {
 
 /* The representation of "frame" 
  * 물리적 메모리 관리를 위한 체계
+ * 사용자 풀의 물리 페이지마다 하나씩 frame_table 배열에 미리 만들어 둔다.
  */
 struct frame {
 	void *kva; //커널 가상 주소
-	struct page *page;
-	struct list_elem frame_elem; //frame_table
-};
+	struct page *page; //대표 페이지 = pages의 첫 번째 페이지
+	bool pinned; //할당 중이거나 swap out 중인 프레임 - 희생자로 고르지 않는다.
+
+	struct list pages; //이 프레임을 공유하는 페이지들 (COW)
+	int share_cnt; //pages에 들어있는 페이지 개수
 
-struct slot {
-	struct page *page;
-	uint32_t slot_num;
-	struct list_elem swap_elem;
+	//파일 페이지를 담고 있으면 (inode, offset)으로 file_frames에 등록된다.
+	struct inode *inode;
+	off_t file_ofs;
+	struct hash_elem file_elem;
 };
 
 /* The function table for page operations.
@@ -110,8 +132,14 @@ struct page_operations
 /* Representation of current process's memory space.
  * We don't want to force you to obey any specific design for this struct.
  * All designs up to you for this. */
+/* 페이지 테이블 모양의 radix tree (vm/spt.c)
+ * 가상 주소 순서대로 순회할 수 있고 페이지 하나에 포인터 하나만 든다. */
 struct supplemental_page_table {
-	struct hash hash_table;
+	void **root;			/* 최상위 노드 (PML4 인덱스) */
+	size_t page_cnt;		/* 들어 있는 페이지 개수 */
+	struct page *last_hit;	/* 마지막으로 찾은 페이지 (spt_find_page 캐시) */
+	size_t locked_cnt;		/* mlock으로 고정한 페이지 개수 */
+	bool dying;				/* 해제 중이라 다른 스레드가 보면 안 됨 (frame_table_lock) */
 };
 
 #include "threads/thread.h"
@@ -125,6 +153,8 @@ bool spt_insert_page (struct supplemental_page_table *spt, struct page *page);
 void spt_remove_page (struct supplemental_page_table *spt, struct page *page);
 
 void vm_init (void);
+void vm_print_stats (void);
+bool vm_prezero_frames (void);
 bool vm_try_handle_fault (struct intr_frame *f, void *addr, bool user,
 		bool write, bool not_present);
 
@@ -134,11 +164,26 @@ bool vm_alloc_page_with_initializer (enum vm_type type, void *upage,
 		bool writable, vm_initializer *init, void *aux);
 void vm_dealloc_page (struct page *page);
 bool vm_claim_page (void *va);
+struct frame *vm_frame_lookup (void *kva);
+void vm_frame_link (struct frame *frame, struct page *page);
+void vm_frame_unlink (struct page *page);
+void vm_frame_release (struct page *page);
+
+/* frame_table을 순회하면서 프레임을 고르는 함수 (frame_table_lock을 잡은 채 호출) */
+typedef bool vm_frame_scan_func (struct frame *frame, void *aux);
+struct frame *vm_frame_scan (size_t *idx, vm_frame_scan_func *func, void *aux);
+void vm_frame_unpin (struct frame *frame);
 enum vm_type page_get_type (struct page *page);
-
-//hash를 위해 추가한 함수
-unsigned page_hash(const struct hash_elem *p_, void *aux UNUSED);
-bool page_less(const struct hash_elem *a_, const struct hash_elem *b_, void *aux UNUSED);
-void hash_page_destroy(struct hash_elem *e, void *aux);
+bool vm_madvise (void *addr, size_t length, int advice);
+bool vm_mlock (void *addr, size_t length);
+void vm_munlock (void *addr, size_t length);
+bool vm_range_free (void *addr, size_t page_cnt);
+void *vm_mremap (void *addr, size_t old_length, size_t new_length,
+		void *new_addr);
+void vm_populate (void *addr, size_t length);
+void vm_msync (void *addr, size_t length);
+bool vm_file_writeback (struct page *page);
+void vm_rusage_swapped (struct page *page, int delta);
+void vm_rusage_print (void);
 
 #endif  /* VM_VM_H */
\ No newline at end of file
@@ -0,0 +1,15 @@
+#ifndef VM_ZSWAP_H
+#define VM_ZSWAP_H
+#include <stddef.h>
+
+/* Maximum kernel memory, in pages, that compressed pages may use.
+   Zero disables the compressed swap tier. */
+extern size_t zswap_max_pages;
+
+void zswap_init (void);
+void *zswap_store (const void *kva);
+void zswap_load (const void *handle, void *kva);
+void zswap_free (void *handle);
+void zswap_print_stats (void);
+
+#endif /* vm/zswap.h */
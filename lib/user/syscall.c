@@ -155,6 +155,42 @@ munmap (void *addr) {
 	syscall1 (SYS_MUNMAP, addr);
 }
 
+int
+madvise (void *addr, size_t length, int advice) {
+	return syscall3 (SYS_MADVISE, addr, length, advice);
+}
+
+int
+mlock (const void *addr, size_t length) {
+	return syscall2 (SYS_MLOCK, addr, length);
+}
+
+int
+munlock (const void *addr, size_t length) {
+	return syscall2 (SYS_MUNLOCK, addr, length);
+}
+
+int
+getrusage (struct rusage *usage) {
+	return syscall1 (SYS_GETRUSAGE, usage);
+}
+
+void *
+mremap (void *addr, size_t old_length, size_t new_length, void *new_addr) {
+	return (void *) syscall4 (SYS_MREMAP, addr, old_length, new_length,
+			new_addr);
+}
+
+int
+msync (void *addr, size_t length) {
+	return syscall2 (SYS_MSYNC, addr, length);
+}
+
+int
+faultstat (int kind, struct faultstat *stat) {
+	return syscall2 (SYS_FAULTSTAT, kind, stat);
+}
+
 bool
 chdir (const char *dir) {
 	return syscall1 (SYS_CHDIR, dir);
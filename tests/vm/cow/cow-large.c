@@ -0,0 +1,51 @@
+/* Forks several children from a parent with a large dirty
+   anonymous region.  Each child must see the parent's data, share
+   the untouched frames with the parent, and get a private copy of
+   the single page it writes, without disturbing the parent. */
+
+#include <string.h>
+#include <syscall.h>
+#include <stdio.h>
+#include <stdint.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+#define PAGE_SIZE 4096
+#define CHUNK_SIZE (2 * 1024 * 1024)
+#define PAGE_COUNT (CHUNK_SIZE / PAGE_SIZE)
+#define CHILD_CNT 4
+
+static char buf[CHUNK_SIZE];
+
+void
+test_main (void)
+{
+  size_t i;
+  int c;
+
+  for (i = 0; i < PAGE_COUNT; i++)
+    memset (buf + i * PAGE_SIZE, (char) i, PAGE_SIZE);
+
+  for (c = 0; c < CHILD_CNT; c++)
+    {
+      size_t target = c * (PAGE_COUNT / CHILD_CNT);
+      void *pa_parent = get_phys_addr (buf);
+      pid_t child = fork ("child");
+
+      if (child == 0)
+        {
+          for (i = 0; i < PAGE_COUNT; i++)
+            if (buf[i * PAGE_SIZE] != (char) i)
+              fail ("child %d: data is inconsistent in page %zu", c, i);
+          if (target != 0 && get_phys_addr (buf) != pa_parent)
+            fail ("child %d: untouched page is not shared", c);
+          buf[target * PAGE_SIZE] = '@';
+          if (buf[target * PAGE_SIZE] != '@')
+            fail ("child %d: write was lost", c);
+          exit (c);
+        }
+      CHECK (wait (child) == c, "wait for child %d", c);
+      CHECK (buf[target * PAGE_SIZE] == (char) target,
+             "parent data intact after child %d", c);
+    }
+}
@@ -0,0 +1,22 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(cow-large) begin
+child: exit(0)
+(cow-large) wait for child 0
+(cow-large) parent data intact after child 0
+child: exit(1)
+(cow-large) wait for child 1
+(cow-large) parent data intact after child 1
+child: exit(2)
+(cow-large) wait for child 2
+(cow-large) parent data intact after child 2
+child: exit(3)
+(cow-large) wait for child 3
+(cow-large) parent data intact after child 3
+(cow-large) end
+cow-large: exit(0)
+EOF
+pass;
@@ -0,0 +1,27 @@
+/* Reads a large initialized data segment front to back.  The
+ * segment is loaded lazily from the executable, so with fault-around
+ * most of its pages are mapped by the fault on a preceding page
+ * instead of taking a fault of their own.  Checks that every page
+ * still holds the contents from the executable. */
+
+#include <stdint.h>
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+#define PAGE_SIZE 4096
+#define PAGE_COUNT 64
+#define DATA_SIZE (PAGE_COUNT * PAGE_SIZE)
+
+static const uint8_t data[DATA_SIZE] = { [0 ... DATA_SIZE - 1] = 0x5a };
+
+void
+test_main (void)
+{
+  size_t i;
+
+  msg ("read %d pages", PAGE_COUNT);
+  for (i = 0; i < DATA_SIZE; i++)
+    if (data[i] != 0x5a)
+      fail ("data is inconsistent at byte %zu", i);
+}
@@ -0,0 +1,10 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected (IGNORE_EXIT_CODES => 1, [<<'END']);
+(fault-around) begin
+(fault-around) read 64 pages
+(fault-around) end
+END
+pass;
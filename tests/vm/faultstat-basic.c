@@ -0,0 +1,42 @@
+/* Touches a fresh anonymous mapping and checks with faultstat()
+ * that anonymous faults were counted, that their latency histogram
+ * adds up to the count, and that an unknown kind is rejected. */
+
+#include <string.h>
+#include <stdint.h>
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+#define PAGE_SIZE 4096
+#define PAGE_COUNT 16
+
+void
+test_main (void)
+{
+  char *p = (char *) 0x10000000;
+  struct faultstat before, after;
+  unsigned long long sum = 0;
+  size_t i;
+
+  CHECK (faultstat (FAULTSTAT_ANON, &before) == 0, "faultstat");
+  CHECK (mmap (p, PAGE_COUNT * PAGE_SIZE, 1 | MAP_ANONYMOUS, -1, 0) == p,
+         "mmap anonymous %d pages", PAGE_COUNT);
+  for (i = 0; i < PAGE_COUNT * PAGE_SIZE; i += PAGE_SIZE)
+    p[i] = 1;
+  CHECK (faultstat (FAULTSTAT_ANON, &after) == 0,
+         "faultstat after touching %d pages", PAGE_COUNT);
+
+  if (after.count <= before.count)
+    fail ("anon faults did not grow");
+  if (after.max_cycles == 0 || after.cycles < after.max_cycles)
+    fail ("fault cycles are inconsistent");
+  for (i = 0; i < FAULTSTAT_BUCKETS; i++)
+    sum += after.hist[i];
+  if (sum != after.count)
+    fail ("histogram holds %llu faults, count is %llu", sum, after.count);
+  msg ("anon faults counted");
+
+  CHECK (faultstat (FAULTSTAT_KINDS, &after) == -1, "reject unknown kind");
+  munmap (p);
+}
@@ -0,0 +1,14 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected (IGNORE_EXIT_CODES => 1, [<<'EOF']);
+(faultstat-basic) begin
+(faultstat-basic) faultstat
+(faultstat-basic) mmap anonymous 16 pages
+(faultstat-basic) faultstat after touching 16 pages
+(faultstat-basic) anon faults counted
+(faultstat-basic) reject unknown kind
+(faultstat-basic) end
+EOF
+pass;
@@ -0,0 +1,36 @@
+/* Touches a buffer and checks with getrusage() that the resident
+ * anonymous page count and the minor fault count grow by at least
+ * the number of pages touched. */
+
+#include <string.h>
+#include <stdint.h>
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+#define PAGE_SIZE 4096
+#define PAGE_COUNT 32
+#define BUF_SIZE (PAGE_COUNT * PAGE_SIZE)
+
+static char buf[BUF_SIZE];
+
+void
+test_main (void)
+{
+  struct rusage before, after;
+  size_t i;
+
+  CHECK (getrusage (&before) == 0, "getrusage");
+  for (i = 0; i < BUF_SIZE; i += PAGE_SIZE)
+    buf[i] = 1;
+  CHECK (getrusage (&after) == 0, "getrusage after touching %d pages",
+         PAGE_COUNT);
+
+  if (after.resident_anon - before.resident_anon < PAGE_COUNT)
+    fail ("resident anon grew by %ld pages",
+          after.resident_anon - before.resident_anon);
+  if (after.minor_faults - before.minor_faults < PAGE_COUNT)
+    fail ("minor faults grew by %ld",
+          after.minor_faults - before.minor_faults);
+  msg ("usage grew");
+}
@@ -0,0 +1,12 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected (IGNORE_EXIT_CODES => 1, [<<'EOF']);
+(getrusage-basic) begin
+(getrusage-basic) getrusage
+(getrusage-basic) getrusage after touching 32 pages
+(getrusage-basic) usage grew
+(getrusage-basic) end
+EOF
+pass;
@@ -0,0 +1,32 @@
+/* Touches every page of a large zero-initialized (BSS) region once,
+ * so that each access takes a separate lazy-allocation fault, then
+ * checks that every page kept the byte written to it and that the
+ * rest of the page still reads as zero. */
+
+#include <string.h>
+#include <stdint.h>
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+#define PAGE_SIZE 4096
+#define REGION_SIZE (4 * 1024 * 1024)
+#define PAGE_COUNT (REGION_SIZE / PAGE_SIZE)
+
+static char region[REGION_SIZE];
+
+void
+test_main (void)
+{
+  size_t i;
+
+  msg ("fault in %d pages", PAGE_COUNT);
+  for (i = 0; i < PAGE_COUNT; i++)
+    region[i * PAGE_SIZE] = (char) i;
+
+  msg ("verify");
+  for (i = 0; i < PAGE_COUNT; i++)
+    if (region[i * PAGE_SIZE] != (char) i
+        || region[i * PAGE_SIZE + PAGE_SIZE / 2] != 0)
+      fail ("data is inconsistent in page %zu", i);
+}
@@ -0,0 +1,11 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected (IGNORE_EXIT_CODES => 1, [<<'EOF']);
+(lazy-bss) begin
+(lazy-bss) fault in 1024 pages
+(lazy-bss) verify
+(lazy-bss) end
+EOF
+pass;
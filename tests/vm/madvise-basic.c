@@ -0,0 +1,76 @@
+/* Exercises madvise() on a large anonymous region.
+ * Checks that bad arguments are rejected, fills the region, drops it
+ * with MADV_DONTNEED and checks that it reads back as zeros, also in a
+ * child forked right after the drop, then
+ * refills it and checks that the data survives MADV_SEQUENTIAL +
+ * MADV_WILLNEED and MADV_RANDOM. */
+
+#include <string.h>
+#include <stdint.h>
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+#define PAGE_SIZE 4096
+#define REGION_SIZE (2 * 1024 * 1024)
+#define PAGE_COUNT (REGION_SIZE / PAGE_SIZE)
+
+static char region[REGION_SIZE];
+
+static void
+fill (void)
+{
+  size_t i;
+
+  for (i = 0; i < PAGE_COUNT; i++)
+    memset (region + i * PAGE_SIZE, (char) i, PAGE_SIZE);
+}
+
+static void
+verify (bool zero)
+{
+  size_t i;
+
+  for (i = 0; i < PAGE_COUNT; i++)
+    {
+      char expected = zero ? 0 : (char) i;
+      if (region[i * PAGE_SIZE] != expected
+          || region[i * PAGE_SIZE + PAGE_SIZE - 1] != expected)
+        fail ("data is inconsistent in page %zu", i);
+    }
+}
+
+void
+test_main (void)
+{
+  pid_t pid;
+
+  CHECK (madvise (region + 1, PAGE_SIZE, MADV_NORMAL) == -1,
+         "madvise misaligned address");
+  CHECK (madvise (region, PAGE_SIZE, 99) == -1, "madvise bad advice");
+
+  msg ("fill %d pages", PAGE_COUNT);
+  fill ();
+  CHECK (madvise (region, REGION_SIZE, MADV_DONTNEED) == 0, "MADV_DONTNEED");
+  pid = fork ("child-dontneed");
+  if (pid == 0)
+    {
+      verify (true);
+      exit (0);
+    }
+  CHECK (pid > 0, "fork after MADV_DONTNEED");
+  CHECK (wait (pid) == 0, "child reads zero pages");
+  msg ("verify zero");
+  verify (true);
+
+  fill ();
+  CHECK (madvise (region, REGION_SIZE, MADV_SEQUENTIAL) == 0,
+         "MADV_SEQUENTIAL");
+  CHECK (madvise (region, REGION_SIZE, MADV_WILLNEED) == 0, "MADV_WILLNEED");
+  msg ("verify sequential");
+  verify (false);
+
+  CHECK (madvise (region, REGION_SIZE, MADV_RANDOM) == 0, "MADV_RANDOM");
+  msg ("verify random");
+  verify (false);
+}
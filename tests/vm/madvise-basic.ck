@@ -0,0 +1,21 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected (IGNORE_EXIT_CODES => 1, [<<'EOF']);
+(madvise-basic) begin
+(madvise-basic) madvise misaligned address
+(madvise-basic) madvise bad advice
+(madvise-basic) fill 512 pages
+(madvise-basic) MADV_DONTNEED
+(madvise-basic) fork after MADV_DONTNEED
+(madvise-basic) child reads zero pages
+(madvise-basic) verify zero
+(madvise-basic) MADV_SEQUENTIAL
+(madvise-basic) MADV_WILLNEED
+(madvise-basic) verify sequential
+(madvise-basic) MADV_RANDOM
+(madvise-basic) verify random
+(madvise-basic) end
+EOF
+pass;
@@ -0,0 +1,45 @@
+/* Locks a buffer with mlock(), fills it, unlocks it with munlock()
+ * and checks its contents.  Also checks that locking a range with
+ * unmapped pages fails, and that locking a fresh anonymous mapping,
+ * which brings its pages in without a fault, gives zeroed pages. */
+
+#include <string.h>
+#include <stdint.h>
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+#define PAGE_SIZE 4096
+#define PAGE_COUNT 32
+#define BUF_SIZE (PAGE_COUNT * PAGE_SIZE)
+
+static char buf[BUF_SIZE];
+static char *anon = (char *) 0x20000000;
+
+void
+test_main (void)
+{
+  size_t i;
+
+  CHECK (mlock ((void *) 0x10000000, PAGE_SIZE) == -1,
+         "mlock unmapped range");
+  CHECK (mlock (buf, BUF_SIZE) == 0, "mlock %d pages", PAGE_COUNT);
+  for (i = 0; i < BUF_SIZE; i++)
+    buf[i] = (char) (i / PAGE_SIZE);
+  CHECK (munlock (buf, BUF_SIZE) == 0, "munlock %d pages", PAGE_COUNT);
+
+  msg ("verify");
+  for (i = 0; i < BUF_SIZE; i++)
+    if (buf[i] != (char) (i / PAGE_SIZE))
+      fail ("data is inconsistent at byte %zu", i);
+
+  CHECK (mmap (anon, BUF_SIZE, 1 | MAP_ANONYMOUS, -1, 0) == anon,
+         "mmap anonymous %d pages", PAGE_COUNT);
+  CHECK (mlock (anon, BUF_SIZE) == 0, "mlock anonymous mapping");
+  for (i = 0; i < BUF_SIZE; i++)
+    if (anon[i] != 0)
+      fail ("byte %zu of locked anonymous page is not zero", i);
+  msg ("verify zero");
+  munlock (anon, BUF_SIZE);
+  munmap (anon);
+}
@@ -0,0 +1,16 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected (IGNORE_EXIT_CODES => 1, [<<'EOF']);
+(mlock-basic) begin
+(mlock-basic) mlock unmapped range
+(mlock-basic) mlock 32 pages
+(mlock-basic) munlock 32 pages
+(mlock-basic) verify
+(mlock-basic) mmap anonymous 32 pages
+(mlock-basic) mlock anonymous mapping
+(mlock-basic) verify zero
+(mlock-basic) end
+EOF
+pass;
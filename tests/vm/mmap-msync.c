@@ -0,0 +1,35 @@
+/* Maps a file with MAP_POPULATE, writes to it through the mapping,
+   flushes it with msync() and reads the data back with the read
+   system call while the mapping is still in place. */
+
+#include <string.h>
+#include <syscall.h>
+#include "tests/vm/sample.inc"
+#include "tests/lib.h"
+#include "tests/main.h"
+
+#define ACTUAL ((void *) 0x10000000)
+
+void
+test_main (void)
+{
+  int handle;
+  void *map;
+  char buf[1024];
+
+  CHECK (create ("sample.txt", strlen (sample)), "create \"sample.txt\"");
+  CHECK ((handle = open ("sample.txt")) > 1, "open \"sample.txt\"");
+  CHECK ((map = mmap (ACTUAL, 4096, 1 | MAP_POPULATE, handle, 0)) != MAP_FAILED,
+         "mmap \"sample.txt\" with MAP_POPULATE");
+  memcpy (ACTUAL, sample, strlen (sample));
+  CHECK (msync (map, 4096) == 0, "msync \"sample.txt\"");
+
+  /* Read back via read() without unmapping. */
+  read (handle, buf, strlen (sample));
+  CHECK (!memcmp (buf, sample, strlen (sample)),
+         "compare read data against written data");
+  CHECK (!memcmp (ACTUAL, sample, strlen (sample)),
+         "mapping is still in place");
+  munmap (map);
+  close (handle);
+}
@@ -0,0 +1,54 @@
+/* Maps anonymous memory with mmap(MAP_ANONYMOUS), checks that it
+ * starts out zeroed, then grows it in place and moves it with
+ * mremap() and checks that the contents follow the mapping. */
+
+#include <string.h>
+#include <stdint.h>
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+#define PAGE_SIZE 4096
+#define PAGE_COUNT 16
+
+static void
+verify (const char *p, size_t pages)
+{
+  size_t i;
+
+  for (i = 0; i < pages * PAGE_SIZE; i++)
+    if (p[i] != (char) (i / PAGE_SIZE + 1))
+      fail ("data is inconsistent at byte %zu", i);
+}
+
+void
+test_main (void)
+{
+  char *p = (char *) 0x10000000;
+  char *q = (char *) 0x20000000;
+  size_t i;
+
+  CHECK (mmap (p, PAGE_COUNT * PAGE_SIZE, 1 | MAP_ANONYMOUS, -1, 0) == p,
+         "mmap anonymous %d pages", PAGE_COUNT);
+  for (i = 0; i < PAGE_COUNT * PAGE_SIZE; i++)
+    if (p[i] != 0)
+      fail ("byte %zu is not zero", i);
+  for (i = 0; i < PAGE_COUNT * PAGE_SIZE; i++)
+    p[i] = (char) (i / PAGE_SIZE + 1);
+  CHECK (mmap (p, PAGE_SIZE, 1 | MAP_ANONYMOUS, -1, 0) == NULL,
+         "mmap over existing mapping");
+
+  CHECK (mremap (p, PAGE_COUNT * PAGE_SIZE, 2 * PAGE_COUNT * PAGE_SIZE,
+                 NULL) == p, "mremap grow in place");
+  for (i = PAGE_COUNT * PAGE_SIZE; i < 2 * PAGE_COUNT * PAGE_SIZE; i++)
+    if (p[i] != 0)
+      fail ("byte %zu is not zero", i);
+  verify (p, PAGE_COUNT);
+
+  CHECK (mremap (p, 2 * PAGE_COUNT * PAGE_SIZE, PAGE_COUNT * PAGE_SIZE,
+                 q) == q, "mremap move");
+  verify (q, PAGE_COUNT);
+
+  munmap (q);
+  msg ("munmap");
+}
@@ -0,0 +1,14 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected (IGNORE_EXIT_CODES => 1, [<<'EOF']);
+(mremap-anon) begin
+(mremap-anon) mmap anonymous 16 pages
+(mremap-anon) mmap over existing mapping
+(mremap-anon) mremap grow in place
+(mremap-anon) mremap move
+(mremap-anon) munmap
+(mremap-anon) end
+EOF
+pass;
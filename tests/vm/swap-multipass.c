@@ -0,0 +1,46 @@
+/* Swaps a working set larger than memory through several passes.
+ * For this test, Pintos memory size is 10MB and the working set is
+ * 24MB, so every pass over the buffer swaps every page out and back
+ * in.  Each pass verifies the previous pass's data and rewrites whole
+ * pages, so swap slots are allocated and released on every fault and
+ * a slot that is reused too early or leaked shows up as bad data. */
+
+#include <string.h>
+#include <stdint.h>
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+#define PAGE_SHIFT 12
+#define PAGE_SIZE (1 << PAGE_SHIFT)
+#define ONE_MB (1 << 20) // 1MB
+#define CHUNK_SIZE (24*ONE_MB)
+#define PAGE_COUNT (CHUNK_SIZE / PAGE_SIZE)
+#define PASS_COUNT 3
+
+static char big_chunks[CHUNK_SIZE];
+
+void
+test_main (void)
+{
+    size_t i, pass;
+    char *mem;
+
+    for (pass = 0; pass < PASS_COUNT; pass++) {
+        msg ("pass %zu", pass);
+        for (i = 0; i < PAGE_COUNT; i++) {
+            mem = big_chunks + i * PAGE_SIZE;
+            if (pass > 0 && (mem[0] != (char) (i + pass - 1)
+                             || mem[PAGE_SIZE - 1] != (char) (i + pass - 1)))
+                fail ("data is inconsistent in page %zu", i);
+            memset (mem, (char) (i + pass), PAGE_SIZE);
+        }
+    }
+
+    for (i = 0; i < PAGE_COUNT; i++) {
+        mem = big_chunks + i * PAGE_SIZE;
+        if (mem[PAGE_SIZE / 2] != (char) (i + PASS_COUNT - 1))
+            fail ("data is inconsistent in page %zu", i);
+    }
+    msg ("check consistency");
+}
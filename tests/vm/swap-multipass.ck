@@ -0,0 +1,13 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected (IGNORE_EXIT_CODES => 1, [<<'EOF']);
+(swap-multipass) begin
+(swap-multipass) pass 0
+(swap-multipass) pass 1
+(swap-multipass) pass 2
+(swap-multipass) check consistency
+(swap-multipass) end
+EOF
+pass;
@@ -31,6 +31,7 @@
 #include "tests/threads/tests.h"
 #ifdef VM
 #include "vm/vm.h"
+#include "vm/zswap.h"
 #endif
 #ifdef FILESYS
 #include "devices/disk.h"
@@ -142,7 +143,13 @@ bss_init (void) {
 
 /* Populates the page table with the kernel virtual mapping,
  * and then sets up the CPU to use the new page directory.
- * Points base_pml4 to the pml4 it creates. */
+ * Points base_pml4 to the pml4 it creates.
+ *
+ * Memory is mapped with 2 MB pages wherever a whole aligned 2 MB
+ * block lies below MEM_END and outside the kernel text, which must
+ * stay read-only at 4 kB granularity.  1 GB pages are never usable:
+ * LOADER_KERN_BASE is 64 MB past a 1 GB boundary, so no virtual and
+ * physical address pair is 1 GB aligned together. */
 static void
 paging_init (uint64_t mem_end) {
 	uint64_t *pml4, *pte;
@@ -150,11 +157,21 @@ paging_init (uint64_t mem_end) {
 	pml4 = base_pml4 = palloc_get_page (PAL_ASSERT | PAL_ZERO);
 
 	extern char start, _end_kernel_text;
+	const uint64_t text_start = (uint64_t) &start;
+	const uint64_t text_end = (uint64_t) &_end_kernel_text;
 	// Maps physical address [0 ~ mem_end] to
 	//   [LOADER_KERN_BASE ~ LOADER_KERN_BASE + mem_end].
 	for (uint64_t pa = 0; pa < mem_end; pa += PGSIZE) {
 		uint64_t va = (uint64_t) ptov(pa);
 
+		if (va % HPGSIZE == 0 && pa % HPGSIZE == 0 && pa + HPGSIZE <= mem_end
+				&& (va + HPGSIZE <= text_start || text_end <= va)) {
+			if ((pte = pml4_pde_walk (pml4, va, 1)) != NULL)
+				*pte = pa | PTE_PS | PTE_P | PTE_W;
+			pa += HPGSIZE - PGSIZE;
+			continue;
+		}
+
 		perm = PTE_P | PTE_W;
 		if ((uint64_t) &start <= va && va < (uint64_t) &_end_kernel_text)
 			perm &= ~PTE_W;
@@ -165,6 +182,7 @@ paging_init (uint64_t mem_end) {
 
 	// reload cr3
 	pml4_activate(0);
+	pml4_pcid_init();
 }
 
 /* Breaks the kernel command line into words and returns them as
@@ -226,6 +244,24 @@ parse_options (char **argv) {
 			user_page_limit = atoi (value);
 		else if (!strcmp (name, "-threads-tests"))
 			thread_tests = true;
+#endif
+#ifdef VM
+		else if (!strcmp (name, "-fa"))
+			vm_fault_around_pages = atoi (value) > 0 ? atoi (value) : 1;
+		else if (!strcmp (name, "-wb-expire"))
+			vm_writeback_expire = atoi (value);
+		else if (!strcmp (name, "-wb-batch"))
+			vm_writeback_batch = atoi (value) > 0 ? atoi (value) : 1;
+		else if (!strcmp (name, "-zswap"))
+			zswap_max_pages = atoi (value);
+		else if (!strcmp (name, "-mlock-limit"))
+			vm_mlock_limit = atoi (value);
+		else if (!strcmp (name, "-rusage"))
+			vm_rusage_report = true;
+		else if (!strcmp (name, "-prezero"))
+			vm_prezero_pages = atoi (value);
+		else if (!strcmp (name, "-no-thp"))
+			vm_huge_pages = false;
 #endif
 		else
 			PANIC ("unknown option `%s' (use -h for help)", name);
@@ -328,6 +364,16 @@ usage (void) {
 			"  -mlfqs             Use multi-level feedback queue scheduler.\n"
 #ifdef USERPROG
 			"  -ul=COUNT          Limit user memory to COUNT pages.\n"
+#endif
+#ifdef VM
+			"  -fa=PAGES          Map up to PAGES file pages per fault.\n"
+			"  -wb-expire=TICKS   Write back file pages dirty for TICKS.\n"
+			"  -wb-batch=PAGES    Write back at most PAGES pages per pass.\n"
+			"  -zswap=PAGES       Keep up to PAGES of compressed swap in RAM.\n"
+			"  -mlock-limit=PAGES Let each process mlock at most PAGES pages.\n"
+			"  -rusage            Print memory usage of each process at exit.\n"
+			"  -prezero=PAGES     Keep up to PAGES zeroed frames ready (0 disables).\n"
+			"  -no-thp            Don't map large anonymous regions with 2 MB pages.\n"
 #endif
 			);
 	power_off ();
@@ -362,4 +408,7 @@ print_stats (void) {
 #ifdef USERPROG
 	exception_print_stats ();
 #endif
+#ifdef VM
+	vm_print_stats ();
+#endif
 }
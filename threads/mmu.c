@@ -2,17 +2,118 @@
 #include <stddef.h>
 #include <string.h>
 #include "threads/init.h"
+#include "threads/interrupt.h"
 #include "threads/pte.h"
 #include "threads/palloc.h"
 #include "threads/thread.h"
 #include "threads/mmu.h"
 #include "intrinsic.h"
 
+/* Process-context identifiers.
+ *
+ * With CR4.PCIDE set, TLB entries are tagged with the PCID in the low
+ * 12 bits of CR3, and a CR3 load with CR3_NOFLUSH set keeps the
+ * entries of every PCID.  Each user pml4 gets a PCID from a small
+ * direct-mapped table indexed by its physical page number; PCID 0
+ * stays with base_pml4.  A pml4 that lost its slot to another one, or
+ * that had a mapping removed, replaced or made clean while it was not
+ * active, has its entries flushed the next time it is activated. */
+#define CPUID_1_ECX_PCID (1 << 17)
+#define CR4_PCIDE (1 << 17)
+#define CR3_NOFLUSH (1ULL << 63)
+#define PCID_SLOTS 256
+
+struct pcid_slot {
+	uint64_t *pml4;             /* Owner, or a null pointer. */
+	bool stale;                 /* Owner's TLB entries must be flushed. */
+};
+
+static bool pcid_enabled;
+static struct pcid_slot pcid_slots[PCID_SLOTS];
+
+static inline size_t
+pcid_index (uint64_t *pml4) {
+	return (vtop (pml4) >> PGBITS) % PCID_SLOTS;
+}
+
+/* Returns the PCID slot owned by PML4, or a null pointer. */
+static struct pcid_slot *
+pcid_lookup (uint64_t *pml4) {
+	struct pcid_slot *slot = &pcid_slots[pcid_index (pml4)];
+	return slot->pml4 == pml4 ? slot : NULL;
+}
+
+/* Enables PCIDs if the CPU supports them.  Must be called while
+ * base_pml4 is active with PCID 0. */
+void
+pml4_pcid_init (void) {
+	uint32_t eax, ebx, ecx, edx;
+
+	cpuid (1, 0, &eax, &ebx, &ecx, &edx);
+	if ((ecx & CPUID_1_ECX_PCID) == 0)
+		return;
+	ASSERT ((rcr3 () & PTE_FLAGS) == 0);
+	lcr4 (rcr4 () | CR4_PCIDE);
+	pcid_enabled = true;
+}
+
+/* Invalidates the TLB entry for VPAGE after its PTE in PML4 changed.
+ * If PML4 is not active and STALE is true, its entries are flushed on
+ * its next activation instead.  STALE should be false when a cached
+ * copy of the old PTE is harmless, as it is when only the accessed
+ * bit changed, so that the clock hand does not make every switch to
+ * PML4 flush.  Called with interrupts off, so that the owner cannot
+ * run between the PTE update and the invalidation. */
+static void
+pml4_invalidate (uint64_t *pml4, const void *vpage, bool stale) {
+	if (PTE_ADDR (rcr3 ()) == vtop (pml4))
+		invlpg ((uint64_t) vpage);
+	else if (pcid_enabled && stale) {
+		struct pcid_slot *slot = pcid_lookup (pml4);
+		if (slot != NULL)
+			slot->stale = true;
+	}
+}
+
+/* Physical address of the 2 MB page mapped by PDE. */
+#define HPG_ADDR(pde) (PTE_ADDR (pde) & ~(HPGSIZE - 1))
+
+/* Replaces the 2 MB mapping in *PDE by a page table that maps the
+ * same memory with 4 kB pages and the same permissions.  The
+ * translation is unchanged, so the TLB needs no invalidation here;
+ * a later change to one of the new PTEs invalidates its address,
+ * which also drops any cached 2 MB entry.  Returns false if memory
+ * allocation fails. */
+static bool
+split_huge_pde (uint64_t *pde) {
+	uint64_t *pt = palloc_get_page (0);
+	if (pt == NULL)
+		return false;
+
+	enum intr_level old_level = intr_disable ();
+	uint64_t base = HPG_ADDR (*pde);
+	uint64_t flags = *pde & (PTE_P | PTE_W | PTE_U | PTE_A | PTE_D);
+	for (size_t i = 0; i < HPG_PAGE_CNT; i++)
+		pt[i] = (base + i * PGSIZE) | flags;
+	*pde = vtop (pt) | PTE_U | PTE_W | PTE_P;
+	intr_set_level (old_level);
+	return true;
+}
+
+/* Returns the PTE for VA in page directory PDP.  If VA is mapped
+ * by a 2 MB page, returns its PDE when CREATE is false, and splits
+ * it into 4 kB pages first when CREATE is true. */
 static uint64_t *
 pgdir_walk (uint64_t *pdp, const uint64_t va, int create) {
 	int idx = PDX (va);
 	if (pdp) {
 		uint64_t *pte = (uint64_t *) pdp[idx];
+		if (((uint64_t) pte & PTE_P) && ((uint64_t) pte & PTE_PS)) {
+			if (!create)
+				return &pdp[idx];
+			if (!split_huge_pde (&pdp[idx]))
+				return NULL;
+		}
 		if (!((uint64_t) pte & PTE_P)) {
 			if (create) {
 				uint64_t *new_page = palloc_get_page (PAL_ZERO);
@@ -60,7 +161,10 @@ pdpe_walk (uint64_t *pdpe, const uint64_t va, int create) {
  * If PML4E does not have a page table for VADDR, behavior depends
  * on CREATE.  If CREATE is true, then a new page table is
  * created and a pointer into it is returned.  Otherwise, a null
- * pointer is returned. */
+ * pointer is returned.
+ * If VADDR lies in a 2 MB page, CREATE also decides: true splits the
+ * page into 4 kB pages, false returns the PDE, which has PTE_PS set
+ * (4 kB PTEs never set that bit, the PAT bit, here). */
 uint64_t *
 pml4e_walk (uint64_t *pml4e, const uint64_t va, int create) {
 	uint64_t *pte = NULL;
@@ -88,6 +192,28 @@ pml4e_walk (uint64_t *pml4e, const uint64_t va, int create) {
 	return pte;
 }
 
+/* Returns the page directory entry for VA in PML4, creating the
+ * upper levels if CREATE is true.  Returns a null pointer if they
+ * are missing or memory allocation fails.  Store a 2 MB mapping
+ * (PTE_PS) in the PDE, or use pml4e_walk() for 4 kB pages. */
+uint64_t *
+pml4_pde_walk (uint64_t *pml4, const uint64_t va, int create) {
+	uint64_t *table = pml4;
+	const int idx[2] = { PML4 (va), PDPE (va) };
+
+	for (int level = 0; level < 2; level++) {
+		uint64_t *entry = &table[idx[level]];
+		if (!(*entry & PTE_P)) {
+			uint64_t *new_page;
+			if (!create || (new_page = palloc_get_page (PAL_ZERO)) == NULL)
+				return NULL;
+			*entry = vtop (new_page) | PTE_U | PTE_W | PTE_P;
+		}
+		table = ptov (PTE_ADDR (*entry));
+	}
+	return &table[PDX (va)];
+}
+
 /* Creates a new page map level 4 (pml4) has mappings for kernel
  * virtual addresses, but none for user virtual addresses.
  * Returns the new page directory, or a null pointer if memory
@@ -122,7 +248,14 @@ pgdir_for_each (uint64_t *pdp, pte_for_each_func *func, void *aux,
 		unsigned pml4_index, unsigned pdp_index) {
 	for (unsigned i = 0; i < PGSIZE / sizeof(uint64_t *); i++) {
 		uint64_t *pte = ptov((uint64_t *) pdp[i]);
-		if (((uint64_t) pte) & PTE_P)
+		if ((pdp[i] & PTE_P) && (pdp[i] & PTE_PS)) {
+			/* A 2 MB page is passed once, as its PDE. */
+			void *va = (void *) (((uint64_t) pml4_index << PML4SHIFT) |
+								 ((uint64_t) pdp_index << PDPESHIFT) |
+								 ((uint64_t) i << PDXSHIFT));
+			if (!func (&pdp[i], va, aux))
+				return false;
+		} else if (((uint64_t) pte) & PTE_P)
 			if (!pt_for_each ((uint64_t *) PTE_ADDR (pte), func, aux,
 					pml4_index, pdp_index, i))
 				return false;
@@ -155,9 +288,11 @@ pml4_for_each (uint64_t *pml4, pte_for_each_func *func, void *aux) {
 	return true;
 }
 
+/* The destroy functions below free the page-table pages, and the
+ * pages mapped by them too if FREE_PAGES is true. */
 static void
-pt_destroy (uint64_t *pt) {
-	for (unsigned i = 0; i < PGSIZE / sizeof(uint64_t *); i++) {
+pt_destroy (uint64_t *pt, bool free_pages) {
+	for (unsigned i = 0; i < PGSIZE / sizeof(uint64_t *) && free_pages; i++) {
 		uint64_t *pte = ptov((uint64_t *) pt[i]);
 		if (((uint64_t) pte) & PTE_P)
 			palloc_free_page ((void *) PTE_ADDR (pte));
@@ -166,44 +301,84 @@ pt_destroy (uint64_t *pt) {
 }
 
 static void
-pgdir_destroy (uint64_t *pdp) {
+pgdir_destroy (uint64_t *pdp, bool free_pages) {
 	for (unsigned i = 0; i < PGSIZE / sizeof(uint64_t *); i++) {
 		uint64_t *pte = ptov((uint64_t *) pdp[i]);
-		if (((uint64_t) pte) & PTE_P)
-			pt_destroy (PTE_ADDR (pte));
+		if ((pdp[i] & PTE_P) && (pdp[i] & PTE_PS)) {
+			if (free_pages)
+				palloc_free_multiple (ptov (HPG_ADDR (pdp[i])), HPG_PAGE_CNT);
+		} else if (((uint64_t) pte) & PTE_P)
+			pt_destroy (PTE_ADDR (pte), free_pages);
 	}
 	palloc_free_page ((void *) pdp);
 }
 
 static void
-pdpe_destroy (uint64_t *pdpe) {
+pdpe_destroy (uint64_t *pdpe, bool free_pages) {
 	for (unsigned i = 0; i < PGSIZE / sizeof(uint64_t *); i++) {
 		uint64_t *pde = ptov((uint64_t *) pdpe[i]);
 		if (((uint64_t) pde) & PTE_P)
-			pgdir_destroy ((void *) PTE_ADDR (pde));
+			pgdir_destroy ((void *) PTE_ADDR (pde), free_pages);
 	}
 	palloc_free_page ((void *) pdpe);
 }
 
-/* Destroys pml4e, freeing all the pages it references. */
-void
-pml4_destroy (uint64_t *pml4) {
+static void
+pml4_destroy_common (uint64_t *pml4, bool free_pages) {
 	if (pml4 == NULL)
 		return;
 	ASSERT (pml4 != base_pml4);
 
+	if (pcid_enabled) {
+		enum intr_level old_level = intr_disable ();
+		struct pcid_slot *slot = pcid_lookup (pml4);
+		if (slot != NULL)
+			slot->pml4 = NULL;
+		intr_set_level (old_level);
+	}
+
 	/* if PML4 (vaddr) >= 1, it's kernel space by define. */
 	uint64_t *pdpe = ptov ((uint64_t *) pml4[0]);
 	if (((uint64_t) pdpe) & PTE_P)
-		pdpe_destroy ((void *) PTE_ADDR (pdpe));
+		pdpe_destroy ((void *) PTE_ADDR (pdpe), free_pages);
 	palloc_free_page ((void *) pml4);
 }
 
+/* Destroys pml4e, freeing all the pages it references. */
+void
+pml4_destroy (uint64_t *pml4) {
+	pml4_destroy_common (pml4, true);
+}
+
+/* Destroys PML4 and its page tables without freeing the pages that
+ * are still mapped, for callers that manage those pages themselves
+ * (the VM frame table).  Whole subtrees go at once, so there is no
+ * need to clear each PTE beforehand. */
+void
+pml4_destroy_tables (uint64_t *pml4) {
+	pml4_destroy_common (pml4, false);
+}
+
 /* Loads page directory PD into the CPU's page directory base
- * register. */
+ * register.  With PCIDs, the TLB entries of PML4 (and of every other
+ * address space) survive the switch unless they may be stale. */
 void
 pml4_activate (uint64_t *pml4) {
-	lcr3 (vtop (pml4 ? pml4 : base_pml4));
+	if (!pcid_enabled || pml4 == NULL || pml4 == base_pml4) {
+		lcr3 (vtop (pml4 ? pml4 : base_pml4) | (pcid_enabled ? CR3_NOFLUSH : 0));
+		return;
+	}
+
+	enum intr_level old_level = intr_disable ();
+	size_t idx = pcid_index (pml4);
+	struct pcid_slot *slot = &pcid_slots[idx];
+	uint64_t cr3 = vtop (pml4) | (idx + 1);
+	if (slot->pml4 == pml4 && !slot->stale)
+		cr3 |= CR3_NOFLUSH;
+	slot->pml4 = pml4;
+	slot->stale = false;
+	lcr3 (cr3);
+	intr_set_level (old_level);
 }
 
 /* Looks up the physical address that corresponds to user virtual
@@ -216,6 +391,8 @@ pml4_get_page (uint64_t *pml4, const void *uaddr) {
 
 	uint64_t *pte = pml4e_walk (pml4, (uint64_t) uaddr, 0);
 
+	if (pte && (*pte & PTE_P) && (*pte & PTE_PS))
+		return ptov (HPG_ADDR (*pte)) + ((uint64_t) uaddr & (HPGSIZE - 1));
 	if (pte && (*pte & PTE_P))
 		return ptov (PTE_ADDR (*pte)) + pg_ofs (uaddr);
 	return NULL;
@@ -238,11 +415,57 @@ pml4_set_page (uint64_t *pml4, void *upage, void *kpage, bool rw) {
 
 	uint64_t *pte = pml4e_walk (pml4, (uint64_t) upage, 1);
 
-	if (pte)
+	if (pte) {
+		enum intr_level old_level = intr_disable ();
+		bool was_present = (*pte & PTE_P) != 0;
 		*pte = vtop (kpage) | PTE_P | (rw ? PTE_W : 0) | PTE_U;
+		if (was_present)
+			pml4_invalidate (pml4, upage, true);
+		intr_set_level (old_level);
+	}
 	return pte != NULL;
 }
 
+/* Maps the 2 MB-aligned user virtual region starting at UPAGE to
+ * the 2 MB of physical memory starting at kernel virtual address
+ * KPAGE with a single PDE, such as memory from
+ * palloc_get_huge_page().  Nothing in the region may be mapped yet.
+ * The mapping is split back into 4 kB pages as soon as one of them
+ * is changed with pml4_set_page() or pml4_clear_page().
+ * Returns true if successful, false if memory allocation failed or
+ * part of the region is mapped. */
+bool
+pml4_set_huge_page (uint64_t *pml4, void *upage, void *kpage, bool rw) {
+	ASSERT (((uint64_t) upage & (HPGSIZE - 1)) == 0);
+	ASSERT ((vtop (kpage) & (HPGSIZE - 1)) == 0);
+	ASSERT (is_user_vaddr (upage));
+	ASSERT (pml4 != base_pml4);
+
+	uint64_t *pde = pml4_pde_walk (pml4, (uint64_t) upage, true);
+	if (pde == NULL)
+		return false;
+
+	/* An empty page table may be left over from earlier mappings. */
+	uint64_t *pt = NULL;
+	if (*pde & PTE_P) {
+		if (*pde & PTE_PS)
+			return false;
+		pt = ptov (PTE_ADDR (*pde));
+		for (size_t i = 0; i < PGSIZE / sizeof *pt; i++)
+			if (pt[i] & PTE_P)
+				return false;
+	}
+
+	enum intr_level old_level = intr_disable ();
+	*pde = vtop (kpage) | PTE_PS | PTE_P | (rw ? PTE_W : 0) | PTE_U;
+	if (pt != NULL)
+		pml4_invalidate (pml4, upage, true);
+	intr_set_level (old_level);
+	if (pt != NULL)
+		palloc_free_page (pt);
+	return true;
+}
+
 /* Marks user virtual page UPAGE "not present" in page
  * directory PD.  Later accesses to the page will fault.  Other
  * bits in the page table entry are preserved.
@@ -254,11 +477,17 @@ pml4_clear_page (uint64_t *pml4, void *upage) {
 	ASSERT (is_user_vaddr (upage));
 
 	pte = pml4e_walk (pml4, (uint64_t) upage, false);
+	if (pte != NULL && (*pte & PTE_P) && (*pte & PTE_PS)) {
+		pte = pml4e_walk (pml4, (uint64_t) upage, true);
+		if (pte == NULL)
+			PANIC ("pml4_clear_page: cannot split 2 MB page");
+	}
 
 	if (pte != NULL && (*pte & PTE_P) != 0) {
+		enum intr_level old_level = intr_disable ();
 		*pte &= ~PTE_P;
-		if (rcr3 () == vtop (pml4))
-			invlpg ((uint64_t) upage);
+		pml4_invalidate (pml4, upage, true);
+		intr_set_level (old_level);
 	}
 }
 
@@ -278,13 +507,17 @@ void
 pml4_set_dirty (uint64_t *pml4, const void *vpage, bool dirty) {
 	uint64_t *pte = pml4e_walk (pml4, (uint64_t) vpage, false);
 	if (pte) {
+		enum intr_level old_level = intr_disable ();
 		if (dirty)
 			*pte |= PTE_D;
 		else
 			*pte &= ~(uint32_t) PTE_D;
 
-		if (rcr3 () == vtop (pml4))
-			invlpg ((uint64_t) vpage);
+		/* A cached entry that is already dirty would let later
+		   writes skip setting PTE_D, so only clearing it needs a
+		   flush. */
+		pml4_invalidate (pml4, vpage, !dirty);
+		intr_set_level (old_level);
 	}
 }
 
@@ -304,12 +537,13 @@ void
 pml4_set_accessed (uint64_t *pml4, const void *vpage, bool accessed) {
 	uint64_t *pte = pml4e_walk (pml4, (uint64_t) vpage, false);
 	if (pte) {
+		enum intr_level old_level = intr_disable ();
 		if (accessed)
 			*pte |= PTE_A;
 		else
 			*pte &= ~(uint32_t) PTE_A;
 
-		if (rcr3 () == vtop (pml4))
-			invlpg ((uint64_t) vpage);
+		pml4_invalidate (pml4, vpage, false);
+		intr_set_level (old_level);
 	}
 }
@@ -9,6 +9,7 @@
 #include <string.h>
 #include "threads/init.h"
 #include "threads/loader.h"
+#include "threads/pte.h"
 #include "threads/synch.h"
 #include "threads/vaddr.h"
 
@@ -258,12 +259,19 @@ palloc_init (void) {
    otherwise from the kernel pool.  If PAL_ZERO is set in FLAGS,
    then the pages are filled with zeros.  If too few pages are
    available, returns a null pointer, unless PAL_ASSERT is set in
-   FLAGS, in which case the kernel panics. */
+   FLAGS, in which case the kernel panics.  If PAL_NOWAIT is set,
+   returns a null pointer instead of waiting when another thread
+   holds the pool, so that threads which must not block (such as
+   the idle thread) can allocate. */
 void *
 palloc_get_multiple (enum palloc_flags flags, size_t page_cnt) {
 	struct pool *pool = flags & PAL_USER ? &user_pool : &kernel_pool;
 
-	lock_acquire (&pool->lock);
+	if (flags & PAL_NOWAIT) {
+		if (!lock_try_acquire (&pool->lock))
+			return NULL;
+	} else
+		lock_acquire (&pool->lock);
 	size_t page_idx = bitmap_scan_and_flip (pool->used_map, 0, page_cnt, false);
 	lock_release (&pool->lock);
 	void *pages;
@@ -296,6 +304,43 @@ palloc_get_page (enum palloc_flags flags) {
 	return palloc_get_multiple (flags, 1);
 }
 
+/* Obtains HPG_PAGE_CNT contiguous free pages whose physical
+   address is 2 MB aligned, so that they can be mapped by one PDE,
+   and returns the kernel virtual address of the first.  FLAGS are
+   as for palloc_get_multiple().  The pages may be freed one at a
+   time later. */
+void *
+palloc_get_huge_page (enum palloc_flags flags) {
+	struct pool *pool = flags & PAL_USER ? &user_pool : &kernel_pool;
+	size_t pool_cnt = bitmap_size (pool->used_map);
+	size_t first = (ROUND_UP (vtop (pool->base), HPGSIZE) - vtop (pool->base))
+			/ PGSIZE;
+	void *pages = NULL;
+
+	if (flags & PAL_NOWAIT) {
+		if (!lock_try_acquire (&pool->lock))
+			return NULL;
+	} else
+		lock_acquire (&pool->lock);
+	for (size_t idx = first; idx + HPG_PAGE_CNT <= pool_cnt;
+			idx += HPG_PAGE_CNT)
+		if (bitmap_none (pool->used_map, idx, HPG_PAGE_CNT)) {
+			bitmap_set_multiple (pool->used_map, idx, HPG_PAGE_CNT, true);
+			pages = pool->base + PGSIZE * idx;
+			break;
+		}
+	lock_release (&pool->lock);
+
+	if (pages) {
+		if (flags & PAL_ZERO)
+			memset (pages, 0, HPGSIZE);
+	} else {
+		if (flags & PAL_ASSERT)
+			PANIC ("palloc_get_huge_page: out of pages");
+	}
+	return pages;
+}
+
 /* Frees the PAGE_CNT pages starting at PAGES. */
 void
 palloc_free_multiple (void *pages, size_t page_cnt) {
@@ -328,6 +373,30 @@ palloc_free_page (void *page) {
 	palloc_free_multiple (page, 1);
 }
 
+/* Returns the number of pages in the user pool. */
+size_t
+palloc_user_page_cnt (void) {
+	return bitmap_size (user_pool.used_map);
+}
+
+/* Returns the number of free pages in the user pool. */
+size_t
+palloc_user_free_cnt (void) {
+	lock_acquire (&user_pool.lock);
+	size_t cnt = bitmap_count (user_pool.used_map, 0,
+			bitmap_size (user_pool.used_map), false);
+	lock_release (&user_pool.lock);
+	return cnt;
+}
+
+/* Returns the index of user pool page PAGE within the user pool,
+   that is, (PAGE - user_pool.base) / PGSIZE. */
+size_t
+palloc_user_page_idx (const void *page) {
+	ASSERT (page_from_pool (&user_pool, (void *) page));
+	return pg_no (page) - pg_no (user_pool.base);
+}
+
 /* Initializes pool P as starting at START and ending at END */
 static void
 init_pool (struct pool *p, void **bm_base, uint64_t start, uint64_t end) {
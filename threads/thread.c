@@ -393,6 +393,17 @@ idle(void *idle_started_ UNUSED)
 		intr_disable();
 		thread_block();
 
+#ifdef VM
+		/* Zero free frames ahead of page faults while there is
+		   nothing else to do.  Go back to the scheduler after each
+		   batch so that a thread that became ready meanwhile runs. */
+		intr_enable();
+		bool zeroed = vm_prezero_frames();
+		intr_disable();
+		if (zeroed)
+			continue;
+#endif
+
 		/* Re-enable interrupts and wait for the next one.
 
 		   The `sti' instruction disables interrupts until the
@@ -5,6 +5,9 @@
 #include "threads/interrupt.h"
 #include "threads/thread.h"
 #include "intrinsic.h"
+#ifdef VM
+#include "vm/faultstat.h"
+#endif
 
 /* Number of page faults processed. */
 static long long page_fault_cnt;
@@ -64,6 +67,9 @@ exception_init (void) {
 void
 exception_print_stats (void) {
 	printf ("Exception: %lld page faults\n", page_fault_cnt);
+#ifdef VM
+	faultstat_print ();
+#endif
 }
 
 /* Handler for an exception (probably) caused by a user process. */
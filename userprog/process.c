@@ -13,6 +13,7 @@
 #include "threads/flags.h"
 #include "threads/init.h"
 #include "threads/interrupt.h"
+#include "threads/malloc.h"
 #include "threads/palloc.h"
 #include "threads/thread.h"
 #include "threads/mmu.h"
@@ -177,6 +178,12 @@ __do_fork(void *aux)
 
 	process_activate(current);
 #ifdef VM
+	//자식의 코드 페이지는 자식이 연 실행 파일을 참조한다. (supplemental_page_table_copy)
+	if (parent->running != NULL) {
+		current->running = file_duplicate(parent->running);
+		if (current->running == NULL)
+			goto error;
+	}
 	supplemental_page_table_init(&current->spt);
 	if (!supplemental_page_table_copy(&current->spt, &parent->spt))
 		goto error;
@@ -318,8 +325,12 @@ void process_exit(void)
 		close(i);
 	}
 	palloc_free_page(curr->fdt);
-	file_close(curr->running);
+#ifdef VM
+	vm_rusage_print();
+#endif
+	//코드 페이지가 실행 파일을 참조하므로 주소 공간을 정리한 다음에 닫는다.
 	process_cleanup();
+	file_close(curr->running);
 	// hash_destroy(&curr->spt.hash_table, NULL);
 	sema_up(&curr->wait_sema);
 	sema_down(&curr->exit_sema);
@@ -350,7 +361,12 @@ process_cleanup(void)
 		 * that's been freed (and cleared). */
 		curr->pml4 = NULL;
 		pml4_activate(NULL);
+#ifdef VM
+		//사용자 페이지는 supplemental_page_table_kill에서 프레임 테이블로 돌려주었다.
+		pml4_destroy_tables(pml4);
+#else
 		pml4_destroy(pml4);
+#endif
 	}
 }
 
@@ -705,7 +721,7 @@ lazy_load_segment(struct page *page, void *aux)
 	struct vm_entry *vme = (struct vm_entry *)aux;
 	file_seek(vme->f, vme->offset);
 	if(file_read(vme->f, page->frame->kva, vme->read_bytes) != (int)(vme->read_bytes)) {
-		palloc_free_page(page->frame->kva);
+		//프레임은 페이지가 destroy 될 때 해제된다.
 		return false;
 	}
 	memset(page->frame->kva + vme->read_bytes, 0, vme->zero_bytes);
@@ -750,7 +766,11 @@ load_segment(struct file *file, off_t ofs, uint8_t *upage,
 		vme->read_bytes = page_read_bytes;
 		vme->zero_bytes = page_zero_bytes;
 		//aux 대신 vme를 넘겨준다.
-		if (!vm_alloc_page_with_initializer(VM_ANON, upage, writable, lazy_load_segment, vme)) {
+		//읽기 전용 코드 페이지는 실행 파일을 backing store로 하는 파일 페이지로 만든다.
+		//같은 프로그램을 실행하는 프로세스들이 프레임을 같이 쓰고, evict 할 때는 swap에
+		//쓰지 않고 버렸다가 다시 실행 파일에서 읽는다.
+		enum vm_type type = !writable && page_read_bytes > 0 ? VM_FILE : VM_ANON;
+		if (!vm_alloc_page_with_initializer(type, upage, writable, lazy_load_segment, vme)) {
 			return false;
 		}
 			
@@ -15,6 +15,9 @@
 #include "filesys/file.h"
 #include "devices/input.h"
 #include "threads/palloc.h"
+#include "vm/faultstat.h"
+
+struct lock filesys_lock;
 
 void syscall_entry(void);
 void syscall_handler(struct intr_frame *);
@@ -38,6 +41,13 @@ unsigned tell(int fd);
 void close(int fd);
 void *mmap(void *addr, size_t length, int writable, int fd, off_t offset);
 void munmap(void *addr);
+int madvise(void *addr, size_t length, int advice);
+int mlock(void *addr, size_t length);
+int munlock(void *addr, size_t length);
+int getrusage(struct vm_rusage *usage);
+void *mremap(void *addr, size_t old_length, size_t new_length, void *new_addr);
+int msync(void *addr, size_t length);
+int faultstat(int kind, struct fault_stat *stat);
 
 /* System call.
  *
@@ -124,6 +134,27 @@ void syscall_handler(struct intr_frame *f UNUSED) {
 	case SYS_MUNMAP:
 		munmap(f->R.rdi);
 		break;
+	case SYS_MADVISE:
+		f->R.rax = madvise(f->R.rdi, f->R.rsi, f->R.rdx);
+		break;
+	case SYS_MLOCK:
+		f->R.rax = mlock(f->R.rdi, f->R.rsi);
+		break;
+	case SYS_MUNLOCK:
+		f->R.rax = munlock(f->R.rdi, f->R.rsi);
+		break;
+	case SYS_GETRUSAGE:
+		f->R.rax = getrusage(f->R.rdi);
+		break;
+	case SYS_MREMAP:
+		f->R.rax = mremap(f->R.rdi, f->R.rsi, f->R.rdx, f->R.r10);
+		break;
+	case SYS_MSYNC:
+		f->R.rax = msync(f->R.rdi, f->R.rsi);
+		break;
+	case SYS_FAULTSTAT:
+		f->R.rax = faultstat(f->R.rdi, f->R.rsi);
+		break;
 	default:
 		exit(-1);
 		break;
@@ -322,8 +353,25 @@ void close(int fd) {
 	process_close_file(fd); // fdt에서 제거하기
 }
 
+/* 파일 fd를 addr에 매핑한다. */
+static void *
+mmap_file(void *addr, size_t length, int writable, int fd, off_t offset) {
+    struct file *f = process_get_file(fd); //fd에 파일이 없을 경우
+    if (f == NULL) {
+		return NULL;
+	}
+    if (file_length(f) == 0 || (int)length <= 0) { //길이가 0이하일 경우
+		return NULL;
+	}
+
+    return do_mmap(addr, length, writable, f, offset); 
+}
+
 //메모리 매핑
 void *mmap(void *addr, size_t length, int writable, int fd, off_t offset) {
+	bool anonymous = (writable & MAP_ANONYMOUS) != 0;
+	bool populate = (writable & MAP_POPULATE) != 0;
+	writable &= ~(MAP_ANONYMOUS | MAP_POPULATE);
 	if(!addr || addr != pg_round_down(addr)) { //addr이 존재하지 않거나 정렬되어 있지 않은 경우
 		return NULL;
 	}
@@ -336,15 +384,16 @@ void *mmap(void *addr, size_t length, int writable, int fd, off_t offset) {
     if (spt_find_page(&thread_current()->spt, addr)) { //addr에 할당된 페이지가 존재할 경우
 		return NULL;
 	}
-    struct file *f = process_get_file(fd); //fd에 파일이 없을 경우
-    if (f == NULL) {
-		return NULL;
+	void *mapped;
+	if (anonymous) { //파일 없이 0으로 채워진 메모리를 매핑하는 경우
+		mapped = (int)length > 0 ? do_mmap_anon(addr, length, writable) : NULL;
+	} else {
+		mapped = mmap_file(addr, length, writable, fd, offset);
 	}
-    if (file_length(f) == 0 || (int)length <= 0) { //길이가 0이하일 경우
-		return NULL;
+	if (mapped != NULL && populate) { //매핑한 구간을 미리 모두 읽어 둔다.
+		vm_populate(mapped, length);
 	}
-
-    return do_mmap(addr, length, writable, f, offset); 
+	return mapped;
 }
 
 //메모리 매핑 해제
@@ -354,4 +403,91 @@ void munmap(void *addr) {
 		exit(-1);
 	}
 	do_munmap(addr);
+}
+
+/* [addr, addr + length) 구간의 메모리 사용 방식을 VM에 알려준다.
+ * 성공하면 0, 인자가 잘못되었으면 -1 */
+int madvise(void *addr, size_t length, int advice) {
+	if (addr == NULL || addr != pg_round_down(addr)) { //정렬되어 있지 않은 경우
+		return -1;
+	}
+	if (!is_user_vaddr(addr) || length > (uint64_t)USER_STACK - (uint64_t)addr) { //사용자 영역을 벗어나는 경우
+		return -1;
+	}
+	return vm_madvise(addr, length, advice) ? 0 : -1;
+}
+
+/* mlock, munlock의 주소 범위가 사용자 영역 안에 있는지 확인 */
+static bool
+lock_range_valid(void *addr, size_t length) {
+	return addr != NULL && is_user_vaddr(addr)
+		&& length <= (uint64_t)USER_STACK - (uint64_t)addr;
+}
+
+/* [addr, addr + length)의 페이지를 메모리에 올리고 evict 되지 않게 고정한다.
+ * 성공하면 0, 구간에 매핑되지 않은 페이지가 있거나 한도를 넘으면 -1 */
+int mlock(void *addr, size_t length) {
+	if (!lock_range_valid(addr, length)) {
+		return -1;
+	}
+	return vm_mlock(addr, length) ? 0 : -1;
+}
+
+/* mlock으로 고정한 페이지를 다시 evict 될 수 있게 한다. */
+int munlock(void *addr, size_t length) {
+	if (!lock_range_valid(addr, length)) {
+		return -1;
+	}
+	vm_munlock(addr, length);
+	return 0;
+}
+
+/* MAP_ANONYMOUS로 만든 매핑의 크기를 바꾸거나 new_addr로 옮긴다.
+ * 성공하면 매핑의 새 주소, 실패하면 NULL */
+void *mremap(void *addr, size_t old_length, size_t new_length, void *new_addr) {
+	if (addr == NULL || addr != pg_round_down(addr) || !is_user_vaddr(addr)) {
+		return NULL;
+	}
+	if ((int)new_length <= 0) { //길이가 0이하일 경우
+		return NULL;
+	}
+	if (new_addr != NULL) { //옮길 주소가 정렬되어 있지 않거나 사용자 영역을 벗어나는 경우
+		if (new_addr != pg_round_down(new_addr) || !is_user_vaddr(new_addr)
+				|| new_length > (uint64_t)USER_STACK - (uint64_t)new_addr) {
+			return NULL;
+		}
+	}
+	return vm_mremap(addr, old_length, new_length, new_addr);
+}
+
+/* [addr, addr + length)에 매핑된 파일 페이지 중 바뀐 것을 파일에 쓴다.
+ * 성공하면 0, 인자가 잘못되었으면 -1 */
+int msync(void *addr, size_t length) {
+	if (addr == NULL || addr != pg_round_down(addr)) { //정렬되어 있지 않은 경우
+		return -1;
+	}
+	if (!is_user_vaddr(addr) || length > (uint64_t)USER_STACK - (uint64_t)addr) { //사용자 영역을 벗어나는 경우
+		return -1;
+	}
+	vm_msync(addr, length);
+	return 0;
+}
+
+/* 현재 프로세스의 메모리 사용량을 usage에 복사한다. */
+int getrusage(struct vm_rusage *usage) {
+	check_address(usage);
+	check_address((void *)usage + sizeof *usage - 1);
+	*usage = thread_current()->rusage;
+	return 0;
+}
+
+/* 시스템 전체에서 KIND 종류의 page fault를 처리한 횟수와 걸린 시간을 STAT에 복사한다. */
+int faultstat(int kind, struct fault_stat *stat) {
+	check_address(stat);
+	check_address((void *)stat + sizeof *stat - 1);
+	if (kind < 0 || kind >= FAULT_KIND_CNT) {
+		return -1;
+	}
+	faultstat_get(kind, stat);
+	return 0;
 }
\ No newline at end of file
@@ -2,6 +2,21 @@
 
 #include "vm/vm.h"
 #include "devices/disk.h"
+#include "threads/vaddr.h"
+#include "threads/mmu.h"
+#include "vm/zswap.h"
+#include <bitmap.h>
+#include <round.h>
+#include <string.h>
+
+/* 한 페이지를 저장하는데 필요한 섹터 수 */
+#define SECTORS_PER_SLOT (PGSIZE / DISK_SECTOR_SIZE)
+
+/* swap 슬롯 사용 여부 : 비트 하나가 슬롯 하나 (1 = 사용 중) */
+static struct bitmap *swap_table;
+static struct lock swap_table_lock;
+/* 다음 빈 슬롯 탐색을 시작할 위치 (next-fit) */
+static size_t swap_hint;
 
 /* DO NOT MODIFY BELOW LINE */
 static struct disk *swap_disk;
@@ -22,18 +37,16 @@ void
 vm_anon_init (void) {
 	/* TODO: Set up the swap_disk. */
 	swap_disk = disk_get(1, 1);
-	list_init(&swap_table);
 	lock_init(&swap_table_lock);
 
-	disk_sector_t swap_size = disk_size(swap_disk) / 8;
-	for (disk_sector_t i = 0; i < swap_size; i++) {
-		struct slot *slot = (struct slot *)malloc(sizeof(struct slot));
-		slot->page = NULL;
-		slot->slot_num = i;
-		lock_acquire(&swap_table_lock);
-		list_push_back(&swap_table, &slot->swap_elem);
-		lock_release(&swap_table_lock);
+	//swap disk가 없으면 슬롯 0개로 시작 - swap out 시 PANIC
+	size_t slot_cnt = swap_disk != NULL ? disk_size(swap_disk) / SECTORS_PER_SLOT : 0;
+	swap_table = bitmap_create(slot_cnt);
+	if (swap_table == NULL) {
+		PANIC("swap table allocation failed");
 	}
+	swap_hint = 0;
+	zswap_init();
 }
 
 /* Initialize the file mapping */
@@ -43,32 +56,123 @@ anon_initializer (struct page *page, enum vm_type type, void *kva) {
 	page->operations = &anon_ops;
 
 	struct anon_page *anon_page = &page->anon;
-	anon_page->slot_num = -1;
+	anon_page->slot_num = SWAP_SLOT_NONE;
+	anon_page->zswap = NULL;
 	return true;
 }
 
+/* 연속된 빈 슬롯 CNT개를 할당하고 첫 번호를 반환한다. 없으면 SWAP_SLOT_NONE */
+static uint32_t
+swap_slot_alloc_multiple (size_t cnt) {
+	lock_acquire(&swap_table_lock);
+	size_t slot = bitmap_scan_and_flip(swap_table, swap_hint, cnt, false);
+	if (slot == BITMAP_ERROR && swap_hint != 0) { //끝까지 없으면 처음부터 다시 탐색
+		slot = bitmap_scan_and_flip(swap_table, 0, cnt, false);
+	}
+	if (slot != BITMAP_ERROR) {
+		swap_hint = slot + cnt;
+	}
+	lock_release(&swap_table_lock);
+	return slot == BITMAP_ERROR ? SWAP_SLOT_NONE : (uint32_t) slot;
+}
+
+/* 빈 슬롯 하나를 할당하고 번호를 반환한다. 없으면 SWAP_SLOT_NONE */
+static uint32_t
+swap_slot_alloc (void) {
+	return swap_slot_alloc_multiple(1);
+}
+
+/* SLOT을 빈 슬롯으로 되돌린다. */
+static void
+swap_slot_free (uint32_t slot) {
+	lock_acquire(&swap_table_lock);
+	ASSERT(bitmap_test(swap_table, slot));
+	bitmap_reset(swap_table, slot);
+	lock_release(&swap_table_lock);
+}
+
+/* SLOTS의 슬롯 CNT개를 한 번에 빈 슬롯으로 되돌린다. (프로세스 종료) */
+void
+anon_swap_slots_free (const uint32_t slots[], size_t cnt) {
+	lock_acquire(&swap_table_lock);
+	for (size_t i = 0; i < cnt; i++) {
+		ASSERT(bitmap_test(swap_table, slots[i]));
+		bitmap_reset(swap_table, slots[i]);
+	}
+	lock_release(&swap_table_lock);
+}
+
 /* Swap in the page by read contents from the swap disk. */
 static bool
 anon_swap_in (struct page *page, void *kva) {
 	struct anon_page *anon_page = &page->anon;
-	disk_sector_t page_slot = anon_page->slot_num;
-	struct slot *slot;
+	uint32_t slot = anon_page->slot_num;
 
-	lock_acquire(&swap_table_lock);
-	for (struct list_elem *e = list_begin(&swap_table); e != list_end(&swap_table); e = list_next(e)) {
-		slot = list_entry(e, struct slot, swap_elem);
-		if(slot->slot_num == page_slot) {
-			for (int i = 0; i < 8; i++) {
-				disk_read(swap_disk, page_slot * 8 + i, kva + DISK_SECTOR_SIZE * i);
-			}
-			slot->page = NULL;
-			anon_page->slot_num = -1;
-			lock_release(&swap_table_lock);
-			return true;
-		}
+	//zswap에 있으면 디스크를 읽지 않고 압축을 푼다.
+	if (anon_page->zswap != NULL) {
+		zswap_load(anon_page->zswap, kva);
+		zswap_free(anon_page->zswap);
+		anon_page->zswap = NULL;
+		vm_rusage_swapped(page, -1);
+		return true;
 	}
-	lock_release(&swap_table_lock);
-	return false;
+	//anon_discard로 내용을 버린 페이지는 0으로 채운다.
+	if (slot == SWAP_SLOT_NONE) {
+		memset(kva, 0, PGSIZE);
+		return true;
+	}
+	for (int i = 0; i < SECTORS_PER_SLOT; i++) {
+		disk_read(swap_disk, slot * SECTORS_PER_SLOT + i, kva + DISK_SECTOR_SIZE * i);
+	}
+	swap_slot_free(slot);
+	anon_page->slot_num = SWAP_SLOT_NONE;
+	vm_rusage_swapped(page, -1);
+	return true;
+}
+
+/* SRC의 swap 슬롯 내용을 KVA로 읽어온다. 슬롯은 SRC가 계속 사용한다. (fork)
+ * anon_discard로 내용을 버린 페이지는 0으로 채운다. */
+bool
+anon_swap_copy (struct page *src, void *kva) {
+	uint32_t slot = src->anon.slot_num;
+
+	if (src->anon.zswap != NULL) {
+		zswap_load(src->anon.zswap, kva);
+		return true;
+	}
+	if (slot == SWAP_SLOT_NONE) {
+		memset(kva, 0, PGSIZE);
+		return true;
+	}
+	for (int i = 0; i < SECTORS_PER_SLOT; i++) {
+		disk_read(swap_disk, slot * SECTORS_PER_SLOT + i, kva + DISK_SECTOR_SIZE * i);
+	}
+	return true;
+}
+
+/* 매핑이 끊긴 PAGE를 SLOT에 쓰고 프레임과의 연결을 끊는다. */
+static void
+swap_write (struct page *page, uint32_t slot) {
+	void *kva = page->frame->kva;
+	for (int i = 0; i < SECTORS_PER_SLOT; i++) {
+		disk_write(swap_disk, slot * SECTORS_PER_SLOT + i, kva + DISK_SECTOR_SIZE * i);
+	}
+	page->anon.slot_num = slot;
+	vm_frame_unlink(page);
+	vm_rusage_swapped(page, 1);
+}
+
+/* 매핑이 끊긴 PAGE를 압축해서 zswap에 보관해 본다.
+ * 압축이 잘 되지 않거나 zswap이 가득 찼으면 false - 디스크에 써야 한다. */
+static bool
+swap_compress (struct page *page) {
+	page->anon.zswap = zswap_store(page->frame->kva);
+	if (page->anon.zswap == NULL) {
+		return false;
+	}
+	vm_frame_unlink(page);
+	vm_rusage_swapped(page, 1);
+	return true;
 }
 
 /* Swap out the page by writing contents to the swap disk. */
@@ -77,43 +181,102 @@ anon_swap_out (struct page *page) {
 	if(page == NULL) {
 		return false;
 	}
-	struct anon_page *anon_page = &page->anon;
-	struct slot *slot;
 
-	lock_acquire(&swap_table_lock);
-	for (struct list_elem *e = list_begin(&swap_table); e != list_end(&swap_table); e = list_next(e)) {
-		slot = list_entry(e, struct slot, swap_elem);
-		if(slot->page == NULL) {
-			for (int i = 0; i < 8; i++) {
-				disk_write(swap_disk, slot->slot_num * 8 + i, page->va + DISK_SECTOR_SIZE * i);
-			}
-			slot->page = page;
-			anon_page->slot_num = slot->slot_num;
-
-			page->frame->page = NULL;
-			page->frame = NULL;
-			pml4_clear_page(thread_current()->pml4, page->va);
-			lock_release(&swap_table_lock);
-			return true;
+	//먼저 매핑을 끊어서 쓰는 동안 페이지가 바뀌지 않게 한다.
+	//현재 스레드가 아니라 페이지를 가진 프로세스의 페이지 테이블에서 지운다.
+	pml4_clear_page(page->owner->pml4, page->va);
+	if (swap_compress(page)) {
+		return true;
+	}
+
+	uint32_t slot = swap_slot_alloc();
+	if (slot == SWAP_SLOT_NONE) {
+		PANIC("insufficient swap space");
+	}
+	swap_write(page, slot);
+	return true;
+}
+
+/* PAGES의 CNT개 페이지를 내보낸다. 압축이 잘 되는 페이지는 zswap에 두고
+ * 나머지는 연속된 슬롯에 순서대로 기록한다.
+ * 디스크에는 섹터 번호가 이어지는 쓰기 한 묶음으로 나간다.
+ * 연속된 슬롯이 없으면 한 페이지씩 따로 슬롯을 할당한다. */
+void
+anon_swap_out_cluster (struct page *pages[], size_t cnt) {
+	struct page *to_disk[SWAP_CLUSTER_PAGES];
+	size_t disk_cnt = 0;
+
+	ASSERT (cnt <= SWAP_CLUSTER_PAGES);
+
+	//모두 매핑을 끊은 다음에 쓴다.
+	for (size_t i = 0; i < cnt; i++) {
+		pml4_clear_page(pages[i]->owner->pml4, pages[i]->va);
+	}
+	for (size_t i = 0; i < cnt; i++) {
+		if (!swap_compress(pages[i])) {
+			to_disk[disk_cnt++] = pages[i];
 		}
 	}
-	lock_release(&swap_table_lock);
-	PANIC("insufficient swap space");
+	if (disk_cnt == 0) {
+		return;
+	}
+
+	uint32_t slot = swap_slot_alloc_multiple(disk_cnt);
+	for (size_t i = 0; i < disk_cnt; i++) {
+		uint32_t page_slot = slot != SWAP_SLOT_NONE ? slot + i : swap_slot_alloc();
+		if (page_slot == SWAP_SLOT_NONE) {
+			PANIC("insufficient swap space");
+		}
+		swap_write(to_disk[i], page_slot);
+	}
 }
 
 /* Destroy the anonymous page. PAGE will be freed by the caller. */
 static void
 anon_destroy (struct page *page) {
+	anon_discard(page);
+}
+
+/* PAGE의 내용을 버린다. 프레임, swap 슬롯, zswap 사본을 모두 놓아주고
+ * 다음에 접근하면 0으로 채워진 페이지가 된다. (MADV_DONTNEED) */
+void
+anon_discard (struct page *page) {
 	struct anon_page *anon_page = &page->anon;
-	struct slot *slot;
 
-	lock_acquire(&swap_table_lock);
-	for (struct list_elem *e = list_begin(&swap_table); e != list_end(&swap_table); e = list_next(e)) {
-		slot = list_entry(e, struct slot, swap_elem);
-		if (slot->slot_num == anon_page->slot_num) {
-			slot->page = NULL;
-			break;
+	vm_frame_release(page);
+	if (anon_page->slot_num != SWAP_SLOT_NONE || anon_page->zswap != NULL) {
+		vm_rusage_swapped(page, -1);
+	}
+	if (anon_page->slot_num != SWAP_SLOT_NONE) {
+		swap_slot_free(anon_page->slot_num);
+		anon_page->slot_num = SWAP_SLOT_NONE;
+	}
+	if (anon_page->zswap != NULL) {
+		zswap_free(anon_page->zswap);
+		anon_page->zswap = NULL;
+	}
+}
+
+/* mmap(MAP_ANONYMOUS) : [ADDR, ADDR + LENGTH)에 0으로 채워진 anon 페이지를
+ * 매핑한다. 프레임은 처음 접근할 때 할당된다. 구간에 이미 페이지가 있으면
+ * 아무것도 만들지 않고 NULL. 해제는 파일 매핑처럼 do_munmap으로 한다. */
+void *
+do_mmap_anon (void *addr, size_t length, bool writable) {
+	struct supplemental_page_table *spt = &thread_current()->spt;
+	size_t page_cnt = DIV_ROUND_UP(length, PGSIZE);
+	uint8_t *upage = addr;
+
+	if (!vm_range_free(addr, page_cnt)) {
+		return NULL;
+	}
+	for (size_t i = 0; i < page_cnt; i++) {
+		if (!vm_alloc_page(VM_ANON, upage + i * PGSIZE, writable)) {
+			while (i-- > 0) {
+				spt_remove_page(spt, spt_find_page(spt, upage + i * PGSIZE));
+			}
+			return NULL;
 		}
 	}
-	lock_release(&swap_table_lock);
+	spt_find_page(spt, addr)->mapped_page_count = page_cnt;
+	return addr;
 }
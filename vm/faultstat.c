@@ -0,0 +1,75 @@
+/* faultstat.c: Per-kind page fault counters and latency histograms.
+ *
+ * vm_try_handle_fault() reads the TSC around each fault it resolves and
+ * reports the elapsed cycles here under the kind of fault it was.  The
+ * counters are printed at shutdown by exception_print_stats() and can
+ * be read at any time with faultstat_get(), which user programs reach
+ * through the faultstat system call. */
+
+#include "vm/faultstat.h"
+#include <debug.h>
+#include <inttypes.h>
+#include <stdio.h>
+#include "threads/interrupt.h"
+
+static struct fault_stat stats[FAULT_KIND_CNT];
+
+static const char *kind_names[FAULT_KIND_CNT] = {
+	[FAULT_STACK] = "stack",
+	[FAULT_ANON] = "anon",
+	[FAULT_FILE] = "file",
+	[FAULT_SWAP] = "swap",
+	[FAULT_WP] = "write-protect",
+};
+
+/* Returns the histogram bucket for a fault that took CYCLES. */
+static int
+hist_bucket (uint64_t cycles) {
+	int bucket = cycles != 0 ? 63 - __builtin_clzll (cycles) : 0;
+	return bucket < FAULT_HIST_BUCKETS ? bucket : FAULT_HIST_BUCKETS - 1;
+}
+
+/* Counts a fault of KIND that took CYCLES to resolve. */
+void
+faultstat_record (enum fault_kind kind, uint64_t cycles) {
+	ASSERT (kind < FAULT_KIND_CNT);
+
+	struct fault_stat *s = &stats[kind];
+	enum intr_level old_level = intr_disable ();
+	s->cnt++;
+	s->cycles += cycles;
+	if (cycles > s->max_cycles)
+		s->max_cycles = cycles;
+	s->hist[hist_bucket (cycles)]++;
+	intr_set_level (old_level);
+}
+
+/* Copies the counters of KIND into *OUT. */
+void
+faultstat_get (enum fault_kind kind, struct fault_stat *out) {
+	ASSERT (kind < FAULT_KIND_CNT);
+
+	enum intr_level old_level = intr_disable ();
+	*out = stats[kind];
+	intr_set_level (old_level);
+}
+
+/* Prints the counters and the non-empty histogram buckets of every
+   kind of fault that happened. */
+void
+faultstat_print (void) {
+	for (int kind = 0; kind < FAULT_KIND_CNT; kind++) {
+		struct fault_stat s;
+		faultstat_get (kind, &s);
+		if (s.cnt == 0)
+			continue;
+
+		printf ("Fault %s: %"PRIu64" faults, %"PRIu64" avg cycles, "
+				"%"PRIu64" max\n",
+				kind_names[kind], s.cnt, s.cycles / s.cnt, s.max_cycles);
+		for (int i = 0; i < FAULT_HIST_BUCKETS; i++)
+			if (s.hist[i] != 0)
+				printf ("  %s2^%d cycles: %"PRIu64"\n",
+						i == FAULT_HIST_BUCKETS - 1 ? ">=" : "", i, s.hist[i]);
+	}
+}
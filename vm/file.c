@@ -1,12 +1,18 @@
 /* file.c: Implementation of memory backed file object (mmaped object). */
 
 #include "vm/vm.h"
+#include "vm/spt.h"
 
 //vm_entry를 위한 헤더파일 추가
 #include "userprog/process.h"
 
 //가상 주소를 위한 헤더파일 추가
 #include "threads/vaddr.h"
+#include "threads/mmu.h"
+#include "threads/malloc.h"
+#include "threads/interrupt.h"
+#include "devices/timer.h"
+#include <stdio.h>
 
 static bool file_backed_swap_in (struct page *page, void *kva);
 static bool file_backed_swap_out (struct page *page);
@@ -20,9 +26,124 @@ static const struct page_operations file_ops = {
 	.type = VM_FILE,
 };
 
+/* writeback 데몬 : 주기적으로 frame_table을 돌면서 dirty 상태로 오래 남아 있는
+ * 파일 페이지를 미리 파일에 써두고 dirty bit를 지운다.
+ * 그러면 munmap이나 종료 시에 한꺼번에 써야 하는 양이 줄어든다. */
+int64_t vm_writeback_expire = 3 * TIMER_FREQ;
+size_t vm_writeback_batch = 32;
+
+static struct semaphore writeback_sema;
+static bool writeback_idle;	/* 파일 페이지가 없어서 mmap을 기다리는 중 */
+static bool writeback_seen;	/* 이번 한 바퀴에서 파일 페이지를 본 적이 있는지 */
+static long long writeback_cnt;	/* 데몬이 쓴 페이지 수 */
+
+/* vm_frame_scan에서 고른 페이지를 쓸 위치 */
+struct writeback {
+	struct file *file;
+	off_t offset;
+	size_t bytes;
+};
+
+static void writeback_daemon (void *aux);
+static void writeback_wake (void);
+
 /* The initializer of file vm */
 void
 vm_file_init (void) {
+	sema_init(&writeback_sema, 0);
+	writeback_idle = true;
+	if (thread_create("writeback", PRI_DEFAULT, writeback_daemon, NULL) == TID_ERROR) {
+		PANIC("cannot start writeback daemon");
+	}
+}
+
+/* FRAME이 파일에 써야 할 때가 된 파일 페이지인지 확인한다. (frame_table_lock)
+ * 그렇다면 dirty bit를 지우고 쓸 위치를 WB에 담는다.
+ * dirty bit를 먼저 지우므로 쓰는 도중에 바뀐 내용은 다음 번에 다시 쓴다. */
+static bool
+writeback_due (struct frame *frame, void *wb_) {
+	struct writeback *wb = wb_;
+	struct page *page = frame->page;
+	if (page->operations->type != VM_FILE) {
+		return false;
+	}
+	writeback_seen = true;
+
+	uint64_t *pml4 = page->owner->pml4;
+	struct file_page *file_page = &page->file;
+	if (frame->share_cnt > 1 || pml4 == NULL || !pml4_is_dirty(pml4, page->va)) {
+		file_page->dirty_since = -1;
+		return false;
+	}
+	int64_t now = timer_ticks();
+	if (file_page->dirty_since < 0) { //처음 dirty로 본 시각부터 센다.
+		file_page->dirty_since = now;
+	}
+	if (now - file_page->dirty_since < vm_writeback_expire) {
+		return false;
+	}
+
+	pml4_set_dirty(pml4, page->va, false);
+	file_page->dirty_since = -1;
+	wb->file = file_page->file;
+	wb->offset = file_page->offset;
+	wb->bytes = file_page->read_bytes;
+	return true;
+}
+
+/* 파일 페이지를 주기적으로 써두는 커널 스레드 */
+static void
+writeback_daemon (void *aux UNUSED) {
+	size_t cursor = 0;
+
+	for (;;) {
+		if (cursor == 0 && !writeback_seen) {
+			//파일 페이지가 하나도 없으면 다음 mmap까지 잠든다.
+			enum intr_level old_level = intr_disable();
+			writeback_idle = true;
+			intr_set_level(old_level);
+			sema_down(&writeback_sema);
+		}
+		timer_sleep(vm_writeback_expire / 2 > 0 ? vm_writeback_expire / 2 : 1);
+
+		if (cursor == 0) {
+			writeback_seen = false;
+		}
+		struct writeback wb;
+		struct frame *frame = NULL;
+		for (size_t i = 0; i < vm_writeback_batch; i++) {
+			frame = vm_frame_scan(&cursor, writeback_due, &wb);
+			if (frame == NULL) {
+				break;
+			}
+			//pin 되어 있으므로 쓰는 동안 프레임이 해제되거나 evict 되지 않는다.
+			file_write_at(wb.file, frame->kva, wb.bytes, wb.offset);
+			vm_frame_unpin(frame);
+			writeback_cnt++;
+		}
+		if (frame == NULL) { //frame_table을 한 바퀴 다 돌았다.
+			cursor = 0;
+		}
+	}
+}
+
+/* 쓰기 가능한 파일 페이지가 메모리에 올라오면 잠든 writeback 데몬을 깨운다. */
+static void
+writeback_wake (void) {
+	enum intr_level old_level = intr_disable();
+	if (writeback_idle) {
+		writeback_idle = false;
+		writeback_seen = true;
+		sema_up(&writeback_sema);
+	}
+	intr_set_level(old_level);
+}
+
+/* writeback 통계를 출력한다. */
+void
+vm_file_print_stats (void) {
+	printf ("Writeback: %lld pages written early (expire %lld ticks, batch %zu)\n",
+			writeback_cnt, vm_writeback_expire, vm_writeback_batch);
 }
 
 /* Initialize the file backed page */
@@ -37,6 +158,10 @@ file_backed_initializer (struct page *page, enum vm_type type, void *kva) {
 	file_page->offset = vme->offset;
 	file_page->read_bytes = vme->read_bytes;
 	file_page->zero_bytes = vme->zero_bytes;
+	file_page->dirty_since = -1;
+	if (page->writable) { //쓸 수 있는 파일 페이지가 메모리에 올라온다.
+		writeback_wake();
+	}
 	return true;
 }
 
@@ -44,23 +169,34 @@ file_backed_initializer (struct page *page, enum vm_type type, void *kva) {
 static bool
 file_backed_swap_in (struct page *page, void *kva) {
 	struct file_page *file_page UNUSED = &page->file;
-	return lazy_load_segment(page, file_page);
+	if (page->writable) {
+		writeback_wake();
+	}
+	//file_page와 vm_entry는 구조가 다르므로 vm_entry를 만들어서 넘긴다.
+	struct vm_entry vme = {
+		.f = file_page->file,
+		.offset = file_page->offset,
+		.read_bytes = file_page->read_bytes,
+		.zero_bytes = file_page->zero_bytes,
+	};
+	return lazy_load_segment(page, &vme);
 }
 
 /* Swap out the page by writeback contents to the file. */
 static bool
 file_backed_swap_out (struct page *page) {
 	struct file_page *file_page UNUSED = &page->file;
-	struct thread *t = thread_current();
-	if(pml4_is_dirty(t->pml4, page->va)) { //dirty bit = 1일 경우 변경사항이 있다.
+	//현재 스레드가 아니라 페이지를 가진 프로세스의 페이지 테이블을 확인한다.
+	uint64_t *pml4 = page->owner->pml4;
+	bool dirty = pml4_is_dirty(pml4, page->va); //dirty bit = 1일 경우 변경사항이 있다.
+	pml4_clear_page(pml4, page->va);
+	if(dirty) {
 		//변경사항을 파일에 저장하기
 		file_write_at(file_page->file, page->frame->kva, file_page->read_bytes, file_page->offset);
 		//dirty bit = 0
-		pml4_set_dirty(thread_current()->pml4, page->va, 0);
+		pml4_set_dirty(pml4, page->va, 0);
 	}
-	page->frame->page = NULL;
-	page->frame = NULL;
-	pml4_clear_page(t->pml4, page->va);
+	vm_frame_unlink(page);
 	return true;
 }
 
@@ -69,12 +205,9 @@ static void
 file_backed_destroy (struct page *page) {
 	struct file_page *file_page UNUSED = &page->file;
 	struct thread *t = thread_current();
-	if(pml4_is_dirty(t->pml4, page->va)) { 
-		//변경사항을 파일에 저장하기
-		file_write_at(file_page->file, page->va, file_page->read_bytes, file_page->offset);
-		//dirty bit = 0
-		pml4_set_dirty(t->pml4, page->va, 0);
-	}
+	//변경사항을 파일에 저장하기 - 프레임을 같이 쓰는 다른 프로세스에서 바뀐 것도 확인한다.
+	vm_file_writeback(page);
+	vm_frame_release(page);
 	pml4_clear_page(t->pml4, page->va);
 }
 
@@ -130,17 +263,22 @@ do_mmap (void *addr, size_t length, int writable, struct file *file, off_t offse
 	return start_addr;
 }
 
+/* do_munmap에서 페이지 하나의 매핑을 해제하고 SPT에서 뺀다. */
+static bool
+munmap_page (struct page *page, void *spt) {
+	spt_remove_page(spt, page);
+	return true;
+}
+
 /* Do the munmap */
 void
 do_munmap (void *addr) {
 	struct supplemental_page_table *spt = &thread_current()->spt;
 	struct page *p = spt_find_page(spt, addr);
-	int count = p->mapped_page_count;
-	for (int i = 0; i < count; i++) {
-		if(p) {
-			destroy(p);
-		}
-		addr += PGSIZE;
-		p = spt_find_page(spt, addr);
+	if (p == NULL) {
+		return;
 	}
-}
\ No newline at end of file
+	//매핑된 구간을 주소 순서대로 한 번에 순회한다.
+	int count = p->mapped_page_count;
+	spt_tree_walk(spt, addr, addr + count * PGSIZE, munmap_page, spt);
+}
@@ -0,0 +1,149 @@
+/* spt.c: Radix tree backend for the supplemental page table.
+ *
+ * The tree has the same shape as the x86-64 page table: four levels of
+ * 512-entry nodes, indexed by the PML4, PDPE, PDX and PTX fields of the
+ * user virtual address.  Leaf entries hold the struct page pointers.
+ *
+ * A lookup is four array indexing steps, a walk visits pages in address
+ * order and only descends into populated subtrees, and each mapped page
+ * costs one pointer slot. */
+
+#include "vm/spt.h"
+#include "threads/palloc.h"
+#include "threads/pte.h"
+
+/* Number of entries in one node. */
+#define SPT_FANOUT (PGSIZE / sizeof (void *))
+/* Depth of the tree, counting the leaf level. */
+#define SPT_LEVELS 4
+
+/* Address bits covered by one entry of a node at each level. */
+static const unsigned level_shift[SPT_LEVELS] = {
+	PML4SHIFT, PDPESHIFT, PDXSHIFT, PTXSHIFT
+};
+
+static inline size_t
+level_index (uint64_t va, int level) {
+	return (va >> level_shift[level]) & (SPT_FANOUT - 1);
+}
+
+/* Initializes SPT as an empty tree. */
+void
+spt_tree_init (struct supplemental_page_table *spt) {
+	spt->root = NULL;
+	spt->page_cnt = 0;
+}
+
+/* Returns the leaf slot for VA in SPT.  If a node on the way is
+ * missing, creates it when CREATE is true and returns a null pointer
+ * otherwise (or if memory allocation fails). */
+static struct page **
+spt_slot (struct supplemental_page_table *spt, const void *va, bool create) {
+	if (spt->root == NULL) {
+		if (!create || (spt->root = palloc_get_page (PAL_ZERO)) == NULL)
+			return NULL;
+	}
+
+	void **node = spt->root;
+	for (int level = 0; level < SPT_LEVELS - 1; level++) {
+		void **child = node[level_index ((uint64_t) va, level)];
+		if (child == NULL) {
+			if (!create || (child = palloc_get_page (PAL_ZERO)) == NULL)
+				return NULL;
+			node[level_index ((uint64_t) va, level)] = child;
+		}
+		node = child;
+	}
+	return (struct page **) &node[level_index ((uint64_t) va, SPT_LEVELS - 1)];
+}
+
+/* Returns the page mapped at page-aligned VA, or a null pointer. */
+struct page *
+spt_tree_find (struct supplemental_page_table *spt, const void *va) {
+	struct page **slot = spt_slot (spt, va, false);
+	return slot != NULL ? *slot : NULL;
+}
+
+/* Inserts PAGE at PAGE->va.  Returns false if the address is already
+ * occupied or memory for the tree nodes runs out. */
+bool
+spt_tree_insert (struct supplemental_page_table *spt, struct page *page) {
+	struct page **slot = spt_slot (spt, page->va, true);
+	if (slot == NULL || *slot != NULL)
+		return false;
+	*slot = page;
+	spt->page_cnt++;
+	return true;
+}
+
+/* Removes the page at page-aligned VA, if any, and returns it.
+ * Interior nodes are kept until the tree is destroyed, so removing
+ * pages while walking the tree is safe. */
+struct page *
+spt_tree_remove (struct supplemental_page_table *spt, const void *va) {
+	struct page **slot = spt_slot (spt, va, false);
+	struct page *page = slot != NULL ? *slot : NULL;
+	if (page != NULL) {
+		*slot = NULL;
+		spt->page_cnt--;
+	}
+	return page;
+}
+
+static bool
+walk_node (void **node, int level, uint64_t base, uint64_t start,
+		uint64_t end, spt_walk_func *func, void *aux) {
+	uint64_t span = 1ULL << level_shift[level];
+	for (size_t i = 0; i < SPT_FANOUT; i++) {
+		uint64_t lo = base + i * span;
+		if (lo >= end)
+			break;
+		if (lo + span <= start || node[i] == NULL)
+			continue;
+
+		if (level == SPT_LEVELS - 1) {
+			if (!func (node[i], aux))
+				return false;
+		} else if (!walk_node (node[i], level + 1, lo, start, end, func, aux))
+			return false;
+	}
+	return true;
+}
+
+/* Calls FUNC on every page in [START, END) in increasing address
+ * order.  Stops early and returns false as soon as FUNC does.  FUNC
+ * may remove the page it is given from SPT. */
+bool
+spt_tree_walk (struct supplemental_page_table *spt, const void *start,
+		const void *end, spt_walk_func *func, void *aux) {
+	if (spt->root == NULL || start >= end)
+		return true;
+	return walk_node (spt->root, 0, 0, (uint64_t) start, (uint64_t) end,
+			func, aux);
+}
+
+static void
+destroy_node (void **node, int level, spt_walk_func *func, void *aux) {
+	for (size_t i = 0; i < SPT_FANOUT; i++) {
+		void *entry = node[i];
+		if (entry == NULL)
+			continue;
+		node[i] = NULL;
+		if (level == SPT_LEVELS - 1) {
+			if (func != NULL)
+				func (entry, aux);
+		} else
+			destroy_node (entry, level + 1, func, aux);
+	}
+	palloc_free_page (node);
+}
+
+/* Calls FUNC on every page (if FUNC is non-null), then frees all the
+ * nodes of the tree.  Leaves SPT empty. */
+void
+spt_tree_destroy (struct supplemental_page_table *spt,
+		spt_walk_func *func, void *aux) {
+	if (spt->root != NULL)
+		destroy_node (spt->root, 0, func, aux);
+	spt_tree_init (spt);
+}
@@ -1,14 +1,102 @@
 /* vm.c: Generic interface for virtual memory objects. */
 
+#include <stdio.h>
+#include <string.h>
+#include <round.h>
+#include <bitmap.h>
+#include <syscall-nr.h>
 #include "threads/malloc.h"
 #include "vm/vm.h"
 #include "vm/inspect.h"
+#include "vm/spt.h"
+#include "vm/zswap.h"
+#include "vm/faultstat.h"
 //pg_round_down() 함수를 위해 추가
 #include "threads/mmu.h"
+//rdtsc() 함수를 위해 추가
+#include "intrinsic.h"
 
 //vm_entry를 위해 추가
 #include "userprog/process.h"
 
+/* 사용자 풀 물리 페이지 번호로 인덱싱하는 프레임 배열 */
+static struct frame *frame_table;
+static size_t frame_cnt;
+struct lock frame_table_lock;
+/* 프레임의 pin이 풀리거나 페이지가 프레임에서 떨어질 때 알린다. (frame_table_lock)
+ * page_frame_settled가 이것을 기다린다. */
+static struct condition frame_unpinned;
+/* clock 알고리즘의 시계 바늘 - 다음에 검사할 frame_table 인덱스 */
+static size_t clock_hand;
+/* 한 번도 쓰지 않은 anon 페이지를 읽을 때 읽기 전용으로 매핑하는 프레임
+ * frame_table에 속하지 않으므로 evict 되지 않는다. */
+static struct frame zero_frame;
+
+/* 파일 페이지를 담은 프레임의 (inode, offset) 색인 (frame_table_lock)
+ * 같은 파일의 같은 위치를 여러 프로세스가 매핑하면 프레임 하나를 같이 쓴다. */
+static struct hash file_frames;
+static hash_hash_func file_frame_hash;
+static hash_less_func file_frame_less;
+
+/* kswapd : 비어 있는 프레임 수가 low 아래로 떨어지면 깨어나서
+ * high가 될 때까지 미리 evict 해둔다. 그러면 page fault에서는 보통
+ * swap out을 기다리지 않고 바로 빈 프레임을 받는다. */
+static size_t free_frame_cnt;		/* 비어 있는 사용자 풀 프레임 수 (frame_table_lock) */
+static size_t free_low_wmark;
+static size_t free_high_wmark;
+static struct semaphore kswapd_sema;
+static bool kswapd_awake;
+static void kswapd (void *aux);
+
+/* idle 스레드가 미리 0으로 채워 둔 사용자 풀 페이지들
+ * 처음 쓰는 anon 페이지(스택 등)의 fault에서 먼저 가져가므로 fault 중에
+ * memset을 하지 않는다. idle 스레드는 락을 기다릴 수 없으므로 인터럽트를
+ * 끄고 다룬다. 이 페이지들도 free_frame_cnt에 들어 있다. */
+#define ZERO_POOL_MAX 256
+static void *zero_pool[ZERO_POOL_MAX];
+static size_t zero_pool_cnt;
+static bool zero_pool_ready;		/* vm_init이 끝나기 전에는 채우지 않는다. */
+size_t vm_prezero_pages = 32;
+
+/* fault-around로 한 번에 매핑할 최대 페이지 수 (fault난 페이지 포함)
+ * 커널 옵션 -fa=PAGES 로 조절, 1이면 끔 */
+size_t vm_fault_around_pages = 8;
+
+/* 프로세스 하나가 mlock으로 고정할 수 있는 최대 페이지 수
+ * 커널 옵션 -mlock-limit=PAGES 로 조절, 0이면 vm_init에서 사용자 풀의 1/8로 정한다. */
+size_t vm_mlock_limit = 0;
+
+/* 2MB로 정렬된 영역 전체가 처음 쓰는 anon 페이지이면 2MB 페이지 하나로 매핑한다.
+ * 커널 옵션 -no-thp 로 끈다. */
+bool vm_huge_pages = true;
+
+/* 커널 옵션 -rusage : 프로세스가 끝날 때 메모리 사용량을 출력한다. */
+bool vm_rusage_report;
+
+/* fault 통계 */
+static long long file_fault_cnt;	/* 파일에서 지연 로딩한 fault 수 */
+static long long fault_around_cnt;	/* fault-around로 미리 매핑한 페이지 수 */
+static long long swap_cluster_cnt;	/* 여러 페이지를 한 번에 swap out 한 횟수 */
+static long long swap_cluster_pages;	/* 그렇게 swap out 한 페이지 수 */
+static long long swap_around_cnt;	/* swap-in readahead로 읽어온 페이지 수 */
+static long long zero_map_cnt;		/* zero_frame으로 매핑한 페이지 수 */
+static long long file_share_cnt;	/* file_frames에서 찾은 프레임을 같이 쓴 횟수 */
+static long long madvise_prefetch_cnt;	/* MADV_WILLNEED로 미리 읽은 페이지 수 */
+static long long madvise_drop_cnt;	/* MADV_DONTNEED로 버린 페이지 수 */
+static long long populate_cnt;		/* MAP_POPULATE로 미리 올린 페이지 수 */
+static long long msync_cnt;		/* msync로 파일에 쓴 페이지 수 */
+static long long kswapd_reclaim_cnt;	/* kswapd가 비운 프레임 수 */
+static long long direct_reclaim_cnt;	/* fault 처리 중에 직접 evict 한 횟수 */
+static long long shared_evict_cnt;	/* 여러 페이지가 공유하던 프레임을 내보낸 횟수 */
+static long long huge_map_cnt;		/* 2MB 페이지로 매핑한 횟수 */
+static long long prezero_cnt;		/* idle 스레드가 0으로 채운 페이지 수 */
+static long long prezero_hit_cnt;	/* fault에서 미리 채운 페이지를 쓴 횟수 */
+static long long prezero_miss_cnt;	/* 미리 채운 페이지가 없어 직접 채운 횟수 */
+
+/* SPT를 가지고 있는 스레드 */
+#define spt_owner(SPT) \
+	((struct thread *) ((uint8_t *) (SPT) - offsetof (struct thread, spt)))
+
 /* Initializes the virtual memory subsystem by invoking each subsystem's
  * intialize codes. */
 void
@@ -22,9 +110,112 @@ vm_init (void) {
 	/* DO NOT MODIFY UPPER LINES. */
 	/* TODO: Your code goes here. */
 
-	//frame_table에 관한 변수 초기화
-	list_init(&frame_table);
+	//frame_table에 관한 변수 초기화 - 사용자 풀 크기만큼 미리 할당
+	frame_cnt = palloc_user_page_cnt();
+	size_t table_pages = DIV_ROUND_UP(frame_cnt * sizeof(struct frame), PGSIZE);
+	frame_table = palloc_get_multiple(PAL_ASSERT | PAL_ZERO, table_pages);
+	for (size_t i = 0; i < frame_cnt; i++) {
+		list_init(&frame_table[i].pages);
+	}
 	lock_init(&frame_table_lock);
+	cond_init(&frame_unpinned);
+	clock_hand = 0;
+
+	//모든 프로세스가 같이 읽는 0으로 채워진 프레임 - 커널 풀에서 할당
+	//share_cnt를 1로 시작해서 해제되거나 쓰기 가능하게 매핑되는 일이 없게 한다.
+	zero_frame.kva = palloc_get_page(PAL_ASSERT | PAL_ZERO);
+	list_init(&zero_frame.pages);
+	zero_frame.share_cnt = 1;
+
+	hash_init(&file_frames, file_frame_hash, file_frame_less, NULL);
+
+	//워터마크는 사용자 풀 크기에 비례해서 잡는다.
+	free_frame_cnt = palloc_user_free_cnt();
+	free_low_wmark = free_frame_cnt / 32 + 1;
+	free_high_wmark = free_low_wmark * 2;
+	if (vm_mlock_limit == 0) {
+		vm_mlock_limit = free_frame_cnt / 8;
+	}
+	if (vm_prezero_pages > ZERO_POOL_MAX) {
+		vm_prezero_pages = ZERO_POOL_MAX;
+	}
+	zero_pool_ready = true;
+	sema_init(&kswapd_sema, 0);
+	kswapd_awake = false;
+	if (thread_create("kswapd", PRI_DEFAULT, kswapd, NULL) == TID_ERROR) {
+		PANIC("cannot start kswapd");
+	}
+}
+
+/* file_frames의 해시 함수 */
+static uint64_t
+file_frame_hash (const struct hash_elem *e, void *aux UNUSED) {
+	const struct frame *frame = hash_entry(e, struct frame, file_elem);
+	return hash_bytes(&frame->inode, sizeof frame->inode) ^ hash_int(frame->file_ofs);
+}
+
+static bool
+file_frame_less (const struct hash_elem *a_, const struct hash_elem *b_,
+		void *aux UNUSED) {
+	const struct frame *a = hash_entry(a_, struct frame, file_elem);
+	const struct frame *b = hash_entry(b_, struct frame, file_elem);
+	if (a->inode != b->inode) {
+		return a->inode < b->inode;
+	}
+	return a->file_ofs < b->file_ofs;
+}
+
+/* Helpers */
+static struct frame *vm_get_victim (void);
+static bool vm_do_claim_page (struct page *page);
+static bool vm_map_frame (struct page *page, struct frame *frame);
+static struct frame *vm_evict_frame (void);
+static void vm_free_frame (struct frame *frame);
+static bool vm_handle_wp (struct page *page);
+
+/* 사용자 풀 프레임을 워터마크 사이로 유지하는 커널 스레드 */
+static void
+kswapd (void *aux UNUSED) {
+	for (;;) {
+		sema_down(&kswapd_sema);
+
+		while (free_frame_cnt < free_high_wmark) {
+			struct frame *frame = vm_evict_frame();
+			if (frame == NULL) { //더 내보낼 페이지가 없다.
+				break;
+			}
+			lock_acquire(&frame_table_lock);
+			vm_free_frame(frame);
+			lock_release(&frame_table_lock);
+			kswapd_reclaim_cnt++;
+		}
+
+		lock_acquire(&frame_table_lock);
+		kswapd_awake = false;
+		lock_release(&frame_table_lock);
+	}
+}
+
+/* VM 통계를 출력한다. */
+void
+vm_print_stats (void) {
+	printf ("VM: %lld file faults, %lld pages mapped by fault-around (window %zu)\n",
+			file_fault_cnt, fault_around_cnt, vm_fault_around_pages);
+	printf ("VM: %lld pages mapped to the zero page, %lld file frames shared\n",
+			zero_map_cnt, file_share_cnt);
+	printf ("VM: %lld 2 MB pages mapped\n", huge_map_cnt);
+	printf ("VM: madvise prefetched %lld pages, dropped %lld pages\n",
+			madvise_prefetch_cnt, madvise_drop_cnt);
+	printf ("VM: %lld pages populated by mmap, %lld pages written by msync\n",
+			populate_cnt, msync_cnt);
+	printf ("Reclaim: %lld frames by kswapd, %lld direct evictions, %lld shared frames\n",
+			kswapd_reclaim_cnt, direct_reclaim_cnt, shared_evict_cnt);
+	printf ("Swap: %lld pages in %lld clustered writes, %lld pages read ahead\n",
+			swap_cluster_pages, swap_cluster_cnt, swap_around_cnt);
+	printf ("Prezero: %lld pages zeroed while idle, %lld used, %lld zeroed in fault\n",
+			prezero_cnt, prezero_hit_cnt, prezero_miss_cnt);
+	vm_file_print_stats ();
+	zswap_print_stats ();
 }
 
 /* Get the type of the page. This function is useful if you want to know the
@@ -41,11 +232,6 @@ page_get_type (struct page *page) {
 	}
 }
 
-/* Helpers */
-static struct frame *vm_get_victim (void);
-static bool vm_do_claim_page (struct page *page);
-static struct frame *vm_evict_frame (void);
-
 /* Create the pending page object with initializer. If you want to create a
  * page, do not create it directly and make it through this function or
  * `vm_alloc_page`. 
@@ -82,6 +268,7 @@ vm_alloc_page_with_initializer (enum vm_type type, void *upage, bool writable,
 		}
 		uninit_new(p, upage, init, type, aux, page_initializer); //VM_UNINIT 타입으로 페이지 생성
 		p->writable = writable;
+		p->owner = thread_current();
 		/* TODO: Insert the page into the spt. */
 		return spt_insert_page(spt, p);
 	}
@@ -93,18 +280,20 @@ err:
  * 추가 페이지 테이블에서 va에 해당하는 페이지 찾는 함수
  */
 struct page * spt_find_page (struct supplemental_page_table *spt UNUSED, void *va UNUSED) {
-	struct page *page = NULL;
-	/* TODO: Fill this function. */
-	page = (struct page *)malloc(sizeof(struct page));
-	page->va = pg_round_down(va);
+	void *upage = pg_round_down(va);
 
-	//va와 동일한 해시 검색
-	struct hash_elem *e = hash_find(&spt->hash_table, &page->hash_elem);
-	free(page); //사용을 완료한 페이지 메모리 해제하기
-	if (e == NULL) { // 없을 경우
+	//같은 페이지에서 연속으로 fault가 나는 경우가 많으므로 마지막 결과를 먼저 확인
+	struct page *last = spt->last_hit;
+	if (last != NULL && last->va == upage) {
+		return last;
+	}
+
+	struct page *page = spt_tree_find(spt, upage);
+	if (page == NULL) { // 없을 경우
 		return NULL;
 	}
-	return hash_entry(e, struct page, hash_elem);
+	spt->last_hit = page;
+	return page;
 }
 
 /* Insert PAGE into spt with validation. 
@@ -112,264 +301,1647 @@ struct page * spt_find_page (struct supplemental_page_table *spt UNUSED, void *v
  * 성공할 경우 : True / 실패할 경우 : False
  */
 bool spt_insert_page (struct supplemental_page_table *spt UNUSED, struct page *page UNUSED) {
-	int succ = false;
 	/* TODO: Fill this function. */
-	struct hash_elem *e = hash_insert(&spt->hash_table, &page->hash_elem);
-	if(e == NULL) { //성공했을 경우
-		succ = true;
-	}
-	return succ;
+	return spt_tree_insert(spt, page);
 }
 
 //SPT에서 페이지 제거하는 함수
 void spt_remove_page (struct supplemental_page_table *spt, struct page *page) {
 	if(page != NULL) {
+		if (spt->last_hit == page) {
+			spt->last_hit = NULL;
+		}
+		if (page->locked) {
+			spt->locked_cnt--;
+		}
+		spt_tree_remove(spt, page->va);
 		vm_dealloc_page(page);
 	}
 	return;
 }
 
+/* FRAME을 매핑한 모든 페이지의 접근 비트를 확인하고 0으로 되돌린다.
+ * 한 곳이라도 최근에 접근했으면 true (frame_table_lock 필요) */
+static bool
+frame_test_and_clear_accessed (struct frame *frame) {
+	bool accessed = false;
+	for (struct list_elem *e = list_begin(&frame->pages); e != list_end(&frame->pages); e = list_next(e)) {
+		struct page *page = list_entry(e, struct page, share_elem);
+		uint64_t *pml4 = page->owner->pml4;
+		//페이지를 가진 프로세스의 페이지 테이블에서 확인해야 한다.
+		if (pml4 != NULL && pml4_is_accessed(pml4, page->va)) {
+			pml4_set_accessed(pml4, page->va, 0);
+			accessed = true;
+		}
+	}
+	return accessed;
+}
+
+/* FRAME을 매핑한 모든 페이지의 dirty bit를 확인하고 0으로 되돌린다.
+ * 한 곳이라도 바뀌었으면 true (frame_table_lock 필요) */
+static bool
+frame_test_and_clear_dirty (struct frame *frame) {
+	bool dirty = false;
+	for (struct list_elem *e = list_begin(&frame->pages); e != list_end(&frame->pages); e = list_next(e)) {
+		struct page *page = list_entry(e, struct page, share_elem);
+		uint64_t *pml4 = page->owner->pml4;
+		if (pml4 != NULL && pml4_is_dirty(pml4, page->va)) {
+			pml4_set_dirty(pml4, page->va, 0);
+			dirty = true;
+		}
+	}
+	return dirty;
+}
+
+/* FRAME을 매핑한 페이지 중 mlock으로 고정되었거나 종료 중인 프로세스의 것이
+ * 있어서 내보낼 수 없으면 true (frame_table_lock 필요) */
+static bool
+frame_unevictable (struct frame *frame) {
+	for (struct list_elem *e = list_begin(&frame->pages); e != list_end(&frame->pages); e = list_next(e)) {
+		struct page *page = list_entry(e, struct page, share_elem);
+		if (page->locked || page->owner->pml4 == NULL) {
+			return true;
+		}
+	}
+	return false;
+}
+
 /* Get the struct frame, that will be evicted. 
  * swap out할 페이지 선택하기
+ * 모든 프로세스의 프레임을 하나의 시계(clock)로 돈다.
  */
 static struct frame *
 vm_get_victim (void) {
 	struct frame *victim = NULL;
 	/* TODO: The policy for eviction is up to you. */
-	struct thread *curr = thread_current();
 
 	lock_acquire(&frame_table_lock);
-	for (struct list_elem *f = list_begin(&frame_table); f != list_end(&frame_table); f = list_next(f)) {
-		victim = list_entry(f, struct frame, frame_elem);
-		if(victim->page == NULL) { //현재 프레임에 페이지가 없으므로 희생자로 선택
-			lock_release(&frame_table_lock);
-			return victim;
-		}
+	//접근 비트를 지우면서 한 바퀴, 그래도 없으면 한 바퀴 더
+	for (size_t i = 0; i < 2 * frame_cnt; i++) {
+		struct frame *frame = &frame_table[clock_hand];
+		clock_hand = (clock_hand + 1) % frame_cnt;
 
-		//PTE에 접근했는지 여부 판단 : 즉 최근에 접급한 적이 있으면
-		if (pml4_is_accessed(curr->pml4, victim->page->va)) {
-			//접근 비트를 0으로 설정
-			pml4_set_accessed(curr->pml4, victim->page->va, 0);
+		//비어 있거나 다른 스레드가 사용 중인 프레임
+		if(frame->page == NULL || frame->pinned) {
+			continue;
 		}
-		else { //최근에 접근한 적이 없으면 희생자로 선택
-			lock_release(&frame_table_lock);
-			return victim;
+		//종료 중인 프로세스의 프레임과 mlock으로 고정된 페이지는 내보내지 않는다.
+		//공유 중인 프레임은 매핑한 페이지를 모두 확인한다.
+		if (frame_unevictable(frame)) {
+			continue;
+		}
+		//최근에 접근한 적이 없으면 희생자로 선택
+		if (!frame_test_and_clear_accessed(frame)) {
+			victim = frame;
+			victim->pinned = true;
+			break;
 		}
 	}
 	lock_release(&frame_table_lock);
 	return victim;
 }
 
+/* 희생자 VICTIM 뒤로 같은 프로세스의 가상 주소가 이어지는 anon 페이지들 중
+ * 함께 내보낼 수 있는 것들을 골라 PAGES에 담고 개수를 반환한다. (PAGES[0]은 희생자)
+ * 최근에 접근했거나 공유, 사용 중인 페이지를 만나면 거기서 멈춘다.
+ * 고른 프레임은 pin 해둔다. */
+static size_t
+vm_get_swap_cluster (struct frame *victim, struct page *pages[]) {
+	struct page *page = victim->page;
+	struct thread *owner = page->owner;
+	size_t cnt = 1;
+
+	pages[0] = page;
+	if (page->operations->type != VM_ANON) {
+		return cnt;
+	}
+
+	lock_acquire(&frame_table_lock);
+	//해제 중인 SPT는 노드와 페이지가 락 없이 사라지므로 들여다보지 않는다.
+	if (owner->spt.dying) {
+		lock_release(&frame_table_lock);
+		return cnt;
+	}
+	for (; cnt < SWAP_CLUSTER_PAGES; cnt++) {
+		void *va = page->va + cnt * PGSIZE;
+		if (!is_user_vaddr(va) || owner->pml4 == NULL) {
+			break;
+		}
+		struct page *next = spt_tree_find(&owner->spt, va);
+		if (next == NULL || next->operations->type != VM_ANON || next->locked) {
+			break;
+		}
+		struct frame *frame = next->frame;
+		if (frame == NULL || frame->pinned || frame->share_cnt > 1
+				|| pml4_is_accessed(owner->pml4, va)) {
+			break;
+		}
+		frame->pinned = true;
+		pages[cnt] = next;
+	}
+	lock_release(&frame_table_lock);
+	return cnt;
+}
+
 /* Evict one page and return the corresponding frame.
  * Return NULL on error.
  * 희생자 swap out 하기
+ * 희생자가 anon 페이지면 이웃 페이지들까지 연속된 swap 슬롯에 한 번에 내보내고
+ * 희생자 외의 프레임은 사용자 풀로 돌려준다.
  */
 static struct frame *
 vm_evict_frame (void) {
 	struct frame *victim UNUSED = vm_get_victim ();
 	/* TODO: swap out the victim and return the evicted frame. */
-	if(victim->page) {
+	if(victim == NULL) {
+		return NULL;
+	}
+	if(victim->page == NULL) {
+		return victim;
+	}
+
+	//공유 중인 프레임은 역매핑(frame->pages)으로 모든 페이지를 내보낸다.
+	//읽기 전용 파일 페이지는 PTE만 지우고 버리고, COW로 공유하던 anon 페이지는
+	//각자 swap 슬롯에 같은 내용을 쓴다. pin 되어 있으므로 그 사이에 새로
+	//연결되는 페이지는 없다.
+	if (victim->share_cnt > 1) {
+		while (victim->page != NULL) {
+			swap_out(victim->page);
+		}
+		shared_evict_cnt++;
+		return victim;
+	}
+
+	struct page *pages[SWAP_CLUSTER_PAGES];
+	struct frame *frames[SWAP_CLUSTER_PAGES];
+	size_t cnt = vm_get_swap_cluster(victim, pages);
+	if (cnt == 1) {
 		swap_out(victim->page);
+		return victim;
+	}
+
+	for (size_t i = 0; i < cnt; i++) {
+		frames[i] = pages[i]->frame;
+	}
+	anon_swap_out_cluster(pages, cnt);
+	swap_cluster_cnt++;
+	swap_cluster_pages += cnt;
+
+	lock_acquire(&frame_table_lock);
+	for (size_t i = 1; i < cnt; i++) {
+		vm_free_frame(frames[i]);
 	}
+	lock_release(&frame_table_lock);
 	return victim;
 }
 
+/* zero_pool에서 페이지 하나를 꺼낸다. 비어 있으면 NULL */
+static void *
+zero_pool_pop (void) {
+	void *kva = NULL;
+	enum intr_level old_level = intr_disable();
+	if (zero_pool_cnt > 0) {
+		kva = zero_pool[--zero_pool_cnt];
+	}
+	intr_set_level(old_level);
+	return kva;
+}
+
+/* idle 스레드에서 호출 : 사용자 풀의 빈 페이지를 0으로 채워 zero_pool에
+ * vm_prezero_pages개까지 쌓아 둔다. 한 번에 조금씩만 하고, 채운 페이지가
+ * 있으면 true를 반환한다. 락을 기다리지 않는다. */
+bool
+vm_prezero_frames (void) {
+	size_t batch = 8;
+	size_t done = 0;
+	if (!zero_pool_ready) {
+		return false;
+	}
+	while (done < batch && zero_pool_cnt < vm_prezero_pages) {
+		//kswapd가 메모리를 확보하려는 중이면 빈 페이지를 가져가지 않는다.
+		if (kswapd_awake) {
+			break;
+		}
+		enum intr_level old_level = intr_disable();
+		void *kva = palloc_get_page(PAL_USER | PAL_NOWAIT);
+		intr_set_level(old_level);
+		if (kva == NULL) {
+			break;
+		}
+		memset(kva, 0, PGSIZE);
+
+		old_level = intr_disable();
+		if (zero_pool_cnt < vm_prezero_pages) {
+			zero_pool[zero_pool_cnt++] = kva;
+			kva = NULL;
+		}
+		intr_set_level(old_level);
+		if (kva != NULL) {
+			palloc_free_page(kva);
+			break;
+		}
+		done++;
+	}
+	prezero_cnt += done;
+	return done > 0;
+}
+
+/* 사용자 풀 페이지 ADDR을 새 프레임으로 잡는다. */
+static struct frame *
+vm_take_frame (void *addr) {
+	struct frame *frame = vm_frame_lookup(addr);
+	lock_acquire(&frame_table_lock);
+	frame->kva = addr;
+	frame->pinned = true;
+	free_frame_cnt--;
+	//low 워터마크 아래로 내려가면 kswapd를 깨운다.
+	bool wake = free_frame_cnt < free_low_wmark && !kswapd_awake;
+	if (wake) {
+		kswapd_awake = true;
+	}
+	lock_release(&frame_table_lock);
+	if (wake) {
+		sema_up(&kswapd_sema);
+	}
+
+	ASSERT (frame->page == NULL);
+	return frame;
+}
+
+/* 사용자 풀에 남은 페이지가 있으면 프레임을 받아온다. 없으면 NULL (evict 하지 않음)
+ * 사용자 풀이 비었으면 zero_pool에 쌓아 둔 페이지도 쓴다. */
+static struct frame *
+vm_get_free_frame (void) {
+	void *addr = palloc_get_page(PAL_USER);
+	if (addr == NULL) {
+		addr = zero_pool_pop();
+	}
+	if (addr == NULL) {
+		return NULL;
+	}
+	return vm_take_frame(addr);
+}
+
 /* palloc() and get frame. If there is no available page, evict the page
  * and return it. This always return valid address. That is, if the user pool
  * memory is full, this function evicts the frame to get the available memory
  * space.*/
 static struct frame *vm_get_frame (void) {
-	struct frame *frame = NULL;
 	/* TODO: Fill this function. */
 	//사용자 풀에서 페이지를 할당받기 - 할당받은 물리 메모리 주소 반환
-	void *addr = palloc_get_page(PAL_USER);
-	if(addr == NULL) {
+	struct frame *frame = vm_get_free_frame();
+	if(frame == NULL) {
 		//할당받을 수 있는 영역이 없을 경우 희생자 선택
 		frame = vm_evict_frame();
-		memset(frame->kva, 0, PGSIZE);
+		if(frame == NULL) {
+			PANIC("no evictable frame");
+		}
+		direct_reclaim_cnt++;
 		frame->page = NULL;
-		return frame;
 	}
 
-	frame = (struct frame *)malloc(sizeof(struct frame));
-	frame->kva = addr;
-	frame->page = NULL;
-
-	lock_acquire(&frame_table_lock);
-	list_push_back(&frame_table, &frame->frame_elem);
-	lock_release(&frame_table_lock);
-
 	ASSERT(frame != NULL);
 	ASSERT (frame->page == NULL);
 
 	return frame;
 }
 
-/* Growing the stack. */
-static void
-vm_stack_growth (void *addr UNUSED) {
-	vm_alloc_page(VM_ANON | VM_MARKER_0, pg_round_down(addr), 1);
+/* 0으로 채워진 프레임을 받아온다. idle 스레드가 미리 채워 둔 것이 있으면
+ * 그것을 쓰고, 없을 때만 직접 0으로 채운다. */
+static struct frame *
+vm_get_zeroed_frame (void) {
+	void *addr = zero_pool_pop();
+	if (addr != NULL) {
+		prezero_hit_cnt++;
+		return vm_take_frame(addr);
+	}
+	struct frame *frame = vm_get_frame();
+	memset(frame->kva, 0, PGSIZE);
+	prezero_miss_cnt++;
+	return frame;
 }
 
-/* Handle the fault on write_protected page */
-static bool
-vm_handle_wp (struct page *page UNUSED) {
+/* 사용자 풀 페이지 KVA를 관리하는 프레임 */
+struct frame *
+vm_frame_lookup (void *kva) {
+	return &frame_table[palloc_user_page_idx(kva)];
 }
 
-/* Return true on success */
-bool vm_try_handle_fault (struct intr_frame *f UNUSED, void *addr UNUSED, bool user UNUSED, bool write UNUSED, bool not_present UNUSED) {
-	struct supplemental_page_table *spt UNUSED = &thread_current ()->spt;
-	struct page *page = NULL;
+/* FRAME의 pin을 풀고 기다리는 스레드를 깨운다. (frame_table_lock 필요) */
+static void
+frame_unpin (struct frame *frame) {
+	frame->pinned = false;
+	cond_broadcast(&frame_unpinned, &frame_table_lock);
+}
 
-	/* TODO: Validate the fault */
-	/* TODO: Your code goes here */
-	
-	// printf("vm_try_handle_fault | vm.c:209\n");
-	if (addr == NULL || is_kernel_vaddr(addr)) {
-		// printf("bad addr | vm.c:213");
-		return false;
-	}
+/* FRAME의 메모리를 사용자 풀에 돌려준다.
+ * frame_table_lock을 잡은 상태에서 호출해야 한다. */
+static void
+vm_free_frame (struct frame *frame) {
+	ASSERT(frame->share_cnt == 0);
+	palloc_free_page(frame->kva);
+	free_frame_cnt++;
+	frame->kva = NULL;
+	frame->page = NULL;
+	frame_unpin(frame);
+}
 
-	if (not_present) { //접근하려는 페이지가 물리 메모리에 존재하지 않을 경우
-		// printf("not present ok | vm.c:218\n");
-		void *rsp = f->rsp;
-		if(!user) {
-			// printf("kernel access | vm.c:221\n");
-			rsp = thread_current()->rsp;
-		}
-		//USER_STACK - (1 << 20) = 스택 최대 크기 = 1MB
-		//x86-64 PUSH 명령어는 스택 포인터를 조정하기 전에 액세스 권한을 확인하므로 스택 포인터 아래 8바이트의 페이지 장애가 발생할 수 있다.
-		if ((USER_STACK - (1 << 20) <= rsp - 8 && rsp - 8 <= addr && addr <= USER_STACK)) {
-			// printf("vm_stack_growth  | vm.c:227\n");
-			vm_stack_growth(addr);
-		}
-		page = spt_find_page(spt, addr);
-		if(page == NULL) {
-			return false;
-		}
-		if (write && (!page->writable)) { //권한이 없는데 쓰려고 하는 경우
-			return false;
-		}
-		return vm_do_claim_page(page);
+/* PAGE를 가진 프로세스의 메모리에 있는 페이지 수를 DELTA만큼 바꾼다. (frame_table_lock)
+ * zero_frame은 프로세스의 메모리로 세지 않는다. */
+static void
+rusage_resident (struct frame *frame, struct page *page, int delta) {
+	struct vm_rusage *ru = &page->owner->rusage;
+	if (frame == &zero_frame) {
+		return;
+	}
+	if (page_get_type(page) == VM_FILE) {
+		ru->resident_file += delta;
+	} else {
+		ru->resident_anon += delta;
 	}
-	// printf("present | vm.c:238\n");
-	return false;
 }
 
-/* Free the page.
- * DO NOT MODIFY THIS FUNCTION. */
+/* PAGE를 가진 프로세스의 swap에 있는 페이지 수를 DELTA만큼 바꾼다. */
 void
-vm_dealloc_page (struct page *page) {
-	destroy (page);
-	free (page);
+vm_rusage_swapped (struct page *page, int delta) {
+	lock_acquire(&frame_table_lock);
+	page->owner->rusage.swapped += delta;
+	lock_release(&frame_table_lock);
 }
 
-/* Claim the page that allocate on VA. */
-bool
-vm_claim_page (void *va UNUSED) {
-	struct page *page = NULL;
-	/* TODO: Fill this function */
-	page = spt_find_page(&thread_current()->spt, va);
-	if(page == NULL) {
-		return false;
+/* -rusage 옵션이 있으면 현재 프로세스의 메모리 사용량을 출력한다. (process_exit) */
+void
+vm_rusage_print (void) {
+	struct thread *curr = thread_current();
+	struct vm_rusage *ru = &curr->rusage;
+	if (!vm_rusage_report || curr->pml4 == NULL) {
+		return;
 	}
-	return vm_do_claim_page (page);
+	printf("%s: rusage: %ld anon, %ld file, %ld swapped pages; "
+			"%ld minor, %ld major faults\n", curr->name,
+			ru->resident_anon, ru->resident_file, ru->swapped,
+			ru->minor_faults, ru->major_faults);
 }
 
-/* Claim the PAGE and set up the mmu. */
-static bool
-vm_do_claim_page (struct page *page) {
-	struct frame *frame = vm_get_frame ();
-
-	/* Set links */
-	frame->page = page;
+/* PAGE가 FRAME을 사용하도록 연결한다. (frame_table_lock 필요) */
+static void
+frame_link (struct frame *frame, struct page *page) {
+	list_push_back(&frame->pages, &page->share_elem);
+	frame->share_cnt++;
+	frame->page = list_entry(list_front(&frame->pages), struct page, share_elem);
 	page->frame = frame;
+	rusage_resident(frame, page, 1);
+}
 
-	/* TODO: Insert page table entry to map page's VA to frame's PA. */
-	bool result = pml4_set_page(thread_current()->pml4, page->va, frame->kva, page->writable);
-	if(result == false) {
-		return false;
+/* PAGE와 프레임의 연결을 끊는다. (frame_table_lock 필요) */
+static void
+frame_unlink (struct page *page) {
+	struct frame *frame = page->frame;
+	list_remove(&page->share_elem);
+	frame->share_cnt--;
+	rusage_resident(frame, page, -1);
+	frame->page = list_empty(&frame->pages) ? NULL
+		: list_entry(list_front(&frame->pages), struct page, share_elem);
+	page->frame = NULL;
+	//evict 중인 프레임을 기다리던 스레드는 이제 PAGE를 볼 수 있다.
+	cond_broadcast(&frame_unpinned, &frame_table_lock);
+
+	//더 이상 파일 내용을 담고 있지 않다.
+	if (frame->share_cnt == 0 && frame->inode != NULL) {
+		hash_delete(&file_frames, &frame->file_elem);
+		frame->inode = NULL;
 	}
+}
 
-	return swap_in (page, frame->kva);
+/* PAGE가 FRAME을 사용하도록 연결한다. */
+void
+vm_frame_link (struct frame *frame, struct page *page) {
+	lock_acquire(&frame_table_lock);
+	frame_link(frame, page);
+	lock_release(&frame_table_lock);
 }
 
-/* Initialize new supplemental page table 
- * 추가 페이지 테이블 초기화하는 함수
- */
-void supplemental_page_table_init (struct supplemental_page_table *spt UNUSED) {
-	hash_init(&spt->hash_table, page_hash, page_less, NULL);
+/* PAGE와 프레임의 연결을 끊는다. 프레임 메모리는 해제하지 않는다. (swap out) */
+void
+vm_frame_unlink (struct page *page) {
+	lock_acquire(&frame_table_lock);
+	frame_unlink(page);
+	lock_release(&frame_table_lock);
 }
 
-/* Copy supplemental page table from src to dst 
- * 자식이 부모의 실행 컨텍스트를 상속해야 할 때 사용 - fork()
- */
-bool
-supplemental_page_table_copy (struct supplemental_page_table *dst UNUSED, struct supplemental_page_table *src UNUSED) {
-	struct hash_iterator i; //해시 테이블 내의 위치
-	hash_first(&i, &src->hash_table); //i를 해시의 첫번째 요소를 가리키도록 초기화
-	while (hash_next(&i)) { // 해시의 다음 요소가 있을 때까지 반복
-		struct page *src_page = hash_entry(hash_cur(&i), struct page, hash_elem);
-		enum vm_type type = src_page->operations->type;
-		void *va = src_page->va;
-		bool writable = src_page->writable;
-
-		if(type == VM_UNINIT) { //초기화되지 않은 페이지인 경우
-			vm_alloc_page_with_initializer(page_get_type(src_page), va, writable, src_page->uninit.init, src_page->uninit.aux);
-		}
-		else if(type == VM_FILE) { //파일 타입일 경우
-			struct vm_entry *vme = (struct vm_entry *)malloc(sizeof(struct vm_entry));
-			vme->f = src_page->file.file;
-			vme->offset = src_page->file.offset;
-			vme->read_bytes = src_page->file.read_bytes;
-			vme->zero_bytes = src_page->file.zero_bytes;
-
-			if(!vm_alloc_page_with_initializer(type, va,writable, NULL, vme)) {
-				return false;
-			}
-			struct page *page = spt_find_page(dst, va);
-			file_backed_initializer(page, type, NULL);
-			page->frame = src_page->frame;
-			pml4_set_page(thread_current()->pml4, page->va, src_page->frame->kva, src_page->writable);
-		}
-		else { //익명 페이지일 경우
-			if(!vm_alloc_page(type, va, writable)) {
-				return false;
-			}
-			if(!vm_claim_page(va)) {
-				return false;
-			}
-			struct page *dst_page = spt_find_page(dst, va);
-			memcpy(dst_page->frame->kva, src_page->frame->kva, PGSIZE);
-		}
+/* frame_table_lock을 잡고 PAGE의 프레임을 돌려준다. 프레임이 없으면 NULL.
+ * 다른 스레드가 pin 한 프레임(evict, writeback 중)은 풀릴 때까지 기다리므로
+ * 돌려받은 프레임은 그 사이에 페이지에서 떨어지지 않는다. 락을 잡은 채 돌아온다. */
+static struct frame *
+page_frame_settled (struct page *page) {
+	lock_acquire(&frame_table_lock);
+	while (page->frame != NULL && page->frame->pinned) {
+		//pin 한 스레드가 우선순위가 낮아도 잠든 동안 진행할 수 있다.
+		cond_wait(&frame_unpinned, &frame_table_lock);
 	}
-	return true;
+	return page->frame;
 }
 
-/* Free the resource hold by the supplemental page table 
- * process_exit() : 프로세스 종료시 호출
- */
+/* PAGE의 매핑을 지우고 프레임을 놓아준다.
+ * 프레임을 공유하는 페이지가 더 이상 없으면 프레임도 해제한다. (destroy) */
 void
-supplemental_page_table_kill (struct supplemental_page_table *spt UNUSED) {
-	/* TODO: Destroy all the supplemental_page_table hold by thread and
-	 * TODO: writeback all the modified contents to the storage. */
-	hash_clear(&spt->hash_table, hash_page_destroy);
-}
-
-//들어온 요소 e의 가상 주소 값을 unsigned int형 범위의 값으로 변경
-unsigned page_hash(const struct hash_elem *p_, void *aux UNUSED) {
-	const struct page *p = hash_entry(p_, struct page, hash_elem);
-	return hash_bytes(&p->va, sizeof p->va);
+vm_frame_release (struct page *page) {
+	//evict 중이면 swap_out이 PAGE를 다 쓰고 떼어낼 때까지 기다린다.
+	struct frame *frame = page_frame_settled(page);
+	if (frame == NULL) {
+		lock_release(&frame_table_lock);
+		return;
+	}
+	if (page->owner->pml4 != NULL) {
+		pml4_clear_page(page->owner->pml4, page->va);
+	}
+	frame_unlink(page);
+	//pin 한 쪽이 아직 사용 중이면 해제는 그쪽에 맡긴다. (vm_frame_unpin)
+	if (frame->share_cnt == 0 && !frame->pinned) {
+		vm_free_frame(frame);
+	}
+	lock_release(&frame_table_lock);
 }
 
-//가상 주소를 비교하여 반환
-bool page_less(const struct hash_elem *a_, const struct hash_elem *b_, void *aux UNUSED) {
-	const struct page *a = hash_entry(a_, struct page, hash_elem);
-	const struct page *b = hash_entry(b_, struct page, hash_elem);
-	return a->va < b->va;
-}
+/* frame_table을 *IDX부터 순서대로 보면서 FUNC가 true를 반환하는 프레임을 찾아
+ * pin 하고 반환한다. *IDX는 다음에 볼 위치로 옮겨진다. 끝까지 없으면 NULL
+ * FUNC는 frame_table_lock을 잡은 채로, 사용 중이고 pin 되지 않은 프레임에만 호출된다. */
+struct frame *
+vm_frame_scan (size_t *idx, vm_frame_scan_func *func, void *aux) {
+	struct frame *found = NULL;
 
-void hash_page_destroy(struct hash_elem *e, void *aux) {
-	struct page *p = hash_entry(e, struct page, hash_elem);
-	vm_dealloc_page(p);
-}
\ No newline at end of file
+	lock_acquire(&frame_table_lock);
+	while (found == NULL && *idx < frame_cnt) {
+		struct frame *frame = &frame_table[(*idx)++];
+		if (frame->page != NULL && !frame->pinned && func(frame, aux)) {
+			frame->pinned = true;
+			found = frame;
+		}
+	}
+	lock_release(&frame_table_lock);
+	return found;
+}
+
+/* vm_frame_scan으로 pin 한 FRAME을 놓아준다.
+ * 그 사이에 프레임을 쓰던 페이지가 모두 없어졌으면 프레임을 해제한다. */
+void
+vm_frame_unpin (struct frame *frame) {
+	lock_acquire(&frame_table_lock);
+	frame_unpin(frame);
+	if (frame->share_cnt == 0) {
+		vm_free_frame(frame);
+	}
+	lock_release(&frame_table_lock);
+}
+
+/* Growing the stack. */
+static void
+vm_stack_growth (void *addr UNUSED) {
+	vm_alloc_page(VM_ANON | VM_MARKER_0, pg_round_down(addr), 1);
+}
+
+/* PAGE가 파일에서 지연 로딩되는 uninit 페이지이면 그 vm_entry를, 아니면 NULL을 반환 */
+static struct vm_entry *
+lazy_file_entry (struct page *page) {
+	if (page == NULL || page->operations->type != VM_UNINIT
+			|| page->uninit.init != lazy_load_segment) {
+		return NULL;
+	}
+	return page->uninit.aux;
+}
+
+/* PAGE에서 fault가 났을 때 함께 읽어 올 페이지 수 (fault난 페이지 포함)
+ * madvise로 받은 힌트에 따라 기본값 NORMAL을 조절한다. */
+static size_t
+readahead_window (struct page *page, size_t normal) {
+	switch (page->advice) {
+		case MADV_RANDOM:
+			return 1;
+		case MADV_SEQUENTIAL:
+			return normal * 4;
+		default:
+			return normal;
+	}
+}
+
+/* fault-around : 방금 파일에서 읽어온 PAGE 뒤에 같은 파일의 다음 내용이 이어지는
+ * uninit 페이지들을 한 번의 fault 처리에서 함께 읽어서 매핑한다.
+ * 남는 프레임이 있을 때만 하고 이를 위해 다른 페이지를 evict 하지는 않는다. */
+static void
+vm_fault_around (struct supplemental_page_table *spt, struct page *page,
+		struct vm_entry *vme) {
+	struct file *file = vme->f;
+	off_t next_ofs = vme->offset + vme->read_bytes;
+	bool full = vme->read_bytes == PGSIZE;
+
+	size_t window = readahead_window(page, vm_fault_around_pages);
+	for (size_t i = 1; i < window && full; i++) {
+		void *va = page->va + i * PGSIZE;
+		if (!is_user_vaddr(va)) {
+			break;
+		}
+		struct page *next = spt_tree_find(spt, va);
+		struct vm_entry *next_vme = lazy_file_entry(next);
+		if (next_vme == NULL || next_vme->f != file || next_vme->offset != next_ofs
+				|| next_vme->read_bytes == 0) {
+			break;
+		}
+		next_ofs += next_vme->read_bytes;
+		full = next_vme->read_bytes == PGSIZE;
+
+		struct frame *frame = vm_get_free_frame();
+		if (frame == NULL || !vm_map_frame(next, frame)) {
+			break;
+		}
+		fault_around_cnt++;
+	}
+}
+
+/* PAGE가 swap out된 anon 페이지이면 그 슬롯 번호를, 아니면 SWAP_SLOT_NONE을 반환 */
+static uint32_t
+swapped_anon_slot (struct page *page) {
+	if (page == NULL || page->operations->type != VM_ANON || page->frame != NULL) {
+		return SWAP_SLOT_NONE;
+	}
+	return page->anon.slot_num;
+}
+
+/* swap-in readahead : 방금 SLOT에서 읽어온 PAGE 뒤로, 이어지는 슬롯에 저장된
+ * 이웃 페이지들을 함께 읽어 매핑한다. 같이 내보낸 페이지들은 디스크에서도
+ * 연속해 있으므로 순서대로 읽게 된다. 남는 프레임이 있을 때만 한다. */
+static void
+vm_swap_around (struct supplemental_page_table *spt, struct page *page,
+		uint32_t slot) {
+	size_t window = readahead_window(page, SWAP_CLUSTER_PAGES);
+	for (size_t i = 1; i < window; i++) {
+		void *va = page->va + i * PGSIZE;
+		if (!is_user_vaddr(va)) {
+			break;
+		}
+		struct page *next = spt_tree_find(spt, va);
+		if (swapped_anon_slot(next) != slot + i) {
+			break;
+		}
+
+		struct frame *frame = vm_get_free_frame();
+		if (frame == NULL || !vm_map_frame(next, frame)) {
+			break;
+		}
+		swap_around_cnt++;
+	}
+}
+
+/* PAGE를 올리려면 swap이나 파일에서 내용을 읽어야 하는지 확인 (major fault) */
+static bool
+page_needs_read (struct page *page) {
+	switch (page->operations->type) {
+		case VM_UNINIT: {
+			struct vm_entry *vme = lazy_file_entry(page);
+			return vme != NULL && vme->read_bytes > 0;
+		}
+		case VM_ANON:
+			return page->frame == NULL && (page->anon.slot_num != SWAP_SLOT_NONE
+					|| page->anon.zswap != NULL);
+		case VM_FILE:
+			return page->frame == NULL;
+		default:
+			return false;
+	}
+}
+
+/* PAGE가 아직 내용이 없는, 0으로 채워질 anon 페이지인지 확인
+ * (스택, 파일에서 읽을 내용이 없는 BSS 페이지) */
+static bool
+zero_fill_page (struct page *page) {
+	if (page->operations->type != VM_UNINIT || VM_TYPE(page->uninit.type) != VM_ANON) {
+		return false;
+	}
+	if (page->uninit.init == NULL) {
+		return true;
+	}
+	struct vm_entry *vme = lazy_file_entry(page);
+	return vme != NULL && vme->read_bytes == 0;
+}
+
+/* PAGE가 읽어 올 내용 없이 0에서 시작하는 anon 페이지(스택 등)인지 확인
+ * BSS처럼 lazy_load_segment가 직접 0으로 채우는 페이지는 제외한다. */
+static bool
+anon_zero_page (struct page *page) {
+	return page->operations->type == VM_UNINIT
+		&& VM_TYPE(page->uninit.type) == VM_ANON && page->uninit.init == NULL;
+}
+
+/* 0으로 채워질 PAGE를 anon 페이지로 만들고 zero_frame에 읽기 전용으로 매핑한다.
+ * 처음 쓸 때 vm_handle_wp에서 자기 프레임으로 복사된다. */
+static bool
+vm_map_zero_page (struct page *page) {
+	struct uninit_page *uninit = &page->uninit;
+	if (!uninit->page_initializer(page, uninit->type, zero_frame.kva)) {
+		return false;
+	}
+	vm_frame_link(&zero_frame, page);
+	zero_map_cnt++;
+	return pml4_set_page(thread_current()->pml4, page->va, zero_frame.kva, false);
+}
+
+/* vm_map_huge에서 2MB 영역의 페이지들을 확인하고 매핑할 때 쓰는 정보 */
+struct huge_map {
+	struct page *first;		/* fault가 난 페이지 */
+	size_t cnt;				/* 확인한 페이지 수 */
+	uint8_t *kva;			/* 2MB 프레임들의 시작 주소 (매핑할 때) */
+};
+
+/* 2MB 페이지로 같이 매핑할 수 있는 페이지인지 확인 (spt_tree_walk) */
+static bool
+huge_candidate (struct page *page, void *aux) {
+	struct huge_map *hm = aux;
+	if (!zero_fill_page(page) || page->frame != NULL
+			|| page->writable != hm->first->writable) {
+		return false;
+	}
+	hm->cnt++;
+	return true;
+}
+
+/* 2MB 프레임의 한 부분을 PAGE에 연결하고 내용을 채운다. (spt_tree_walk) */
+static bool
+huge_fill (struct page *page, void *aux) {
+	struct huge_map *hm = aux;
+	struct frame *frame = vm_take_frame(hm->kva + hm->cnt++ * PGSIZE);
+	if (anon_zero_page(page)) {
+		memset(frame->kva, 0, PGSIZE);
+	}
+	vm_frame_link(frame, page);
+	//BSS 페이지는 lazy_load_segment가 0으로 채운다.
+	return swap_in(page, frame->kva);
+}
+
+/* 매핑을 마친 2MB 프레임들을 evict 할 수 있게 한다. (spt_tree_walk, frame_table_lock 필요) */
+static bool
+huge_unpin (struct page *page, void *aux UNUSED) {
+	frame_unpin(page->frame);
+	return true;
+}
+
+/* PAGE가 들어 있는 2MB 정렬 영역의 페이지 512개가 모두 처음 쓰는 anon 페이지이면
+ * 정렬된 물리 페이지 512개를 받아 2MB 페이지 하나로 매핑한다.
+ * 나중에 그중 한 페이지라도 evict 되거나 권한이 바뀌면 pml4_clear_page 등이
+ * 4KB 페이지들로 나눈다. 메모리가 넉넉할 때만 한다. */
+static bool
+vm_map_huge (struct supplemental_page_table *spt, struct page *page) {
+	uint8_t *base = (uint8_t *) ((uint64_t) page->va & ~(HPGSIZE - 1));
+	struct huge_map hm = { .first = page, .cnt = 0 };
+
+	if (!vm_huge_pages || !page->writable
+			|| free_frame_cnt < HPG_PAGE_CNT + free_high_wmark) {
+		return false;
+	}
+	if (!spt_tree_walk(spt, base, base + HPGSIZE, huge_candidate, &hm)
+			|| hm.cnt != HPG_PAGE_CNT) {
+		return false;
+	}
+	hm.kva = palloc_get_huge_page(PAL_USER);
+	if (hm.kva == NULL) {
+		return false;
+	}
+
+	hm.cnt = 0;
+	bool success = spt_tree_walk(spt, base, base + HPGSIZE, huge_fill, &hm);
+	if (success) {
+		success = pml4_set_huge_page(thread_current()->pml4, base, hm.kva, true);
+	}
+	if (!success) {
+		//연결한 페이지들은 4KB씩 매핑한다. 내용은 이미 채워져 있다.
+		for (size_t i = 0; i < hm.cnt; i++) {
+			pml4_set_page(thread_current()->pml4, base + i * PGSIZE,
+					hm.kva + i * PGSIZE, true);
+		}
+		//하나도 연결하지 못한 나머지 프레임은 돌려준다.
+		for (size_t i = hm.cnt; i < HPG_PAGE_CNT; i++) {
+			palloc_free_page(hm.kva + i * PGSIZE);
+		}
+	}
+	lock_acquire(&frame_table_lock);
+	spt_tree_walk(spt, base, base + hm.cnt * PGSIZE, huge_unpin, NULL);
+	lock_release(&frame_table_lock);
+	if (success) {
+		huge_map_cnt++;
+	}
+	return success;
+}
+
+/* PAGE가 파일에서 내용을 읽어 와야 하는 파일 페이지이면 그 위치를 알려준다. */
+static bool
+file_page_location (struct page *page, struct file **file, off_t *ofs,
+		size_t *read_bytes) {
+	if (page->operations->type == VM_UNINIT) {
+		struct vm_entry *vme = lazy_file_entry(page);
+		if (vme == NULL || VM_TYPE(page->uninit.type) != VM_FILE) {
+			return false;
+		}
+		*file = vme->f;
+		*ofs = vme->offset;
+		*read_bytes = vme->read_bytes;
+		return true;
+	}
+	if (page->operations->type == VM_FILE && page->frame == NULL) {
+		*file = page->file.file;
+		*ofs = page->file.offset;
+		*read_bytes = page->file.read_bytes;
+		return true;
+	}
+	return false;
+}
+
+/* 파일 페이지 PAGE가 올라온 FRAME을 file_frames에 등록한다.
+ * 같은 위치가 이미 등록되어 있으면 그대로 둔다.
+ * 쓰기 가능한 페이지의 프레임은 다른 페이지와 같이 쓰지 않으므로 등록하지 않는다. */
+static void
+file_frame_insert (struct frame *frame, struct page *page) {
+	lock_acquire(&frame_table_lock);
+	if (frame->inode == NULL) {
+		frame->inode = file_get_inode(page->file.file);
+		frame->file_ofs = page->file.offset;
+		if (hash_insert(&file_frames, &frame->file_elem) != NULL) {
+			frame->inode = NULL;
+		}
+	}
+	lock_release(&frame_table_lock);
+}
+
+/* 같은 파일의 같은 위치가 이미 다른 페이지에 의해 메모리에 있으면
+ * 파일을 다시 읽지 않고 그 프레임을 PAGE에 같이 매핑한다.
+ * 마지막 페이지처럼 읽는 길이가 다르면 같이 쓰지 않는다.
+ * 읽기 전용 페이지끼리만 같이 쓴다. 쓰기 가능한 매핑이 실행 중인 프로그램의
+ * 코드 프레임에 바로 쓰면 안 되기 때문이다. */
+static bool
+vm_map_file_frame (struct page *page) {
+	struct file *file;
+	off_t ofs;
+	size_t read_bytes;
+	if (page->writable || !file_page_location(page, &file, &ofs, &read_bytes)) {
+		return false;
+	}
+
+	struct frame key;
+	key.inode = file_get_inode(file);
+	key.file_ofs = ofs;
+
+	lock_acquire(&frame_table_lock);
+	struct hash_elem *e = hash_find(&file_frames, &key.file_elem);
+	struct frame *frame = e != NULL ? hash_entry(e, struct frame, file_elem) : NULL;
+	if (frame == NULL || frame->pinned || frame->page->file.read_bytes != read_bytes) {
+		lock_release(&frame_table_lock);
+		return false;
+	}
+	if (page->operations->type == VM_UNINIT) {
+		//lazy_load_segment를 거치지 않으므로 vm_entry는 여기서 놓아준다.
+		struct vm_entry *vme = page->uninit.aux;
+		page->uninit.page_initializer(page, page->uninit.type, frame->kva);
+		free(vme);
+	}
+	frame_link(frame, page);
+	frame->pinned = true; //매핑하는 동안 evict 되지 않게 한다.
+	lock_release(&frame_table_lock);
+
+	bool ok = pml4_set_page(thread_current()->pml4, page->va, frame->kva, page->writable);
+	vm_frame_unpin(frame);
+	file_share_cnt++;
+	return ok;
+}
+
+/* MADV_NORMAL, MADV_RANDOM, MADV_SEQUENTIAL : 페이지의 readahead 방식을 바꾼다. */
+static bool
+madvise_set (struct page *page, void *advice) {
+	page->advice = (uintptr_t) advice;
+	return true;
+}
+
+/* MADV_WILLNEED : 아직 메모리에 없는 페이지를 미리 읽어서 매핑한다.
+ * 남는 프레임이 없으면 멈춘다. (다른 페이지를 evict 하지는 않는다.) */
+static bool
+madvise_willneed (struct page *page, void *aux UNUSED) {
+	if (page->frame != NULL || zero_fill_page(page)) {
+		return true;
+	}
+	//내용을 버린 anon 페이지도 읽어 올 것이 없다.
+	if (page->operations->type == VM_ANON && page->anon.slot_num == SWAP_SLOT_NONE
+			&& page->anon.zswap == NULL) {
+		return true;
+	}
+	if (vm_map_file_frame(page)) {
+		return true;
+	}
+	struct frame *frame = vm_get_free_frame();
+	if (frame == NULL || !vm_map_frame(page, frame)) {
+		return false;
+	}
+	madvise_prefetch_cnt++;
+	return true;
+}
+
+/* MADV_DONTNEED : anon 페이지의 내용을 바로 버린다.
+ * 다음에 접근하면 0으로 채워진 페이지가 된다. */
+static bool
+madvise_dontneed (struct page *page, void *aux UNUSED) {
+	if (page->operations->type != VM_ANON || page->locked) {
+		return true;
+	}
+	//evict 중인 페이지는 건드리지 않는다.
+	lock_acquire(&frame_table_lock);
+	bool busy = page->frame != NULL && page->frame->pinned;
+	lock_release(&frame_table_lock);
+	if (!busy) {
+		anon_discard(page);
+		madvise_drop_cnt++;
+	}
+	return true;
+}
+
+/* madvise 시스템 콜 : [ADDR, ADDR + LENGTH) 구간의 페이지를 어떻게 사용할지 알려준다.
+ * ADVICE가 잘못되었으면 false */
+bool
+vm_madvise (void *addr, size_t length, int advice) {
+	struct supplemental_page_table *spt = &thread_current()->spt;
+	void *end = pg_round_up(addr + length);
+
+	switch (advice) {
+		case MADV_NORMAL:
+		case MADV_RANDOM:
+		case MADV_SEQUENTIAL:
+			spt_tree_walk(spt, addr, end, madvise_set, (void *) (uintptr_t) advice);
+			return true;
+		case MADV_WILLNEED:
+			spt_tree_walk(spt, addr, end, madvise_willneed, NULL);
+			return true;
+		case MADV_DONTNEED:
+			spt_tree_walk(spt, addr, end, madvise_dontneed, NULL);
+			return true;
+		default:
+			return false;
+	}
+}
+
+/* vm_mlock에서 구간의 페이지 수를 센다. */
+struct mlock_count {
+	size_t pages;		/* 구간에 있는 페이지 수 */
+	size_t unlocked;	/* 그 중 아직 고정되지 않은 페이지 수 */
+};
+
+static bool
+mlock_count_page (struct page *page, void *cnt_) {
+	struct mlock_count *cnt = cnt_;
+	cnt->pages++;
+	if (!page->locked) {
+		cnt->unlocked++;
+	}
+	return true;
+}
+
+/* vm_mlock 한 번의 진행 상태 */
+struct mlock_walk {
+	struct supplemental_page_table *spt;
+	uint8_t *start;			/* 구간의 시작 주소 */
+	struct bitmap *locked;	/* 이번 호출에서 고정한 페이지 (실패하면 되돌린다) */
+};
+
+/* PAGE가 COW로 공유 중인 쓰기 가능한 anon 페이지인지 확인
+ * 파일 페이지는 공유 프레임에 써야 파일에 반영되므로 나누지 않는다. */
+static bool
+mlock_needs_split (struct page *page, struct frame *frame) {
+	return page->writable && page->operations->type == VM_ANON
+		&& frame->share_cnt > 1;
+}
+
+/* PAGE를 메모리에 올리고 고정한다. COW로 공유 중인 anon 페이지는 미리 나눠서
+ * 나중에 fault가 나지 않게 한다. 다 올린 뒤에 고정하므로 실패하면 PAGE는
+ * 고정되지 않은 채로 남는다. */
+static bool
+mlock_page (struct page *page, void *mw_) {
+	struct mlock_walk *mw = mw_;
+	if (page->locked) {
+		return true;
+	}
+	for (;;) {
+		//이미 희생자로 골라져 pin 된 프레임은 evict가 끝날 때까지 기다린 뒤에 본다.
+		//pin 되지 않은 프레임에 락을 잡은 채 표시하면 더 이상 희생자로 골라지지 않는다.
+		struct frame *frame = page_frame_settled(page);
+		bool ready = frame != NULL && !mlock_needs_split(page, frame);
+		if (ready) {
+			page->locked = true;
+			mw->spt->locked_cnt++;
+		}
+		lock_release(&frame_table_lock);
+		if (ready) {
+			bitmap_mark(mw->locked, ((uint8_t *) page->va - mw->start) / PGSIZE);
+			return true;
+		}
+		//메모리에 없으면 올리고, COW로 공유 중이면 나눈 뒤 다시 확인한다.
+		if (frame == NULL ? !vm_do_claim_page(page) : !vm_handle_wp(page)) {
+			return false;
+		}
+	}
+}
+
+/* vm_mlock이 실패하면 이번 호출에서 고정한 페이지를 다시 풀어 준다. */
+static bool
+mlock_undo_page (struct page *page, void *mw_) {
+	struct mlock_walk *mw = mw_;
+	if (bitmap_test(mw->locked, ((uint8_t *) page->va - mw->start) / PGSIZE)) {
+		page->locked = false;
+		mw->spt->locked_cnt--;
+	}
+	return true;
+}
+
+static bool
+munlock_page (struct page *page, void *spt_) {
+	struct supplemental_page_table *spt = spt_;
+	if (page->locked) {
+		page->locked = false;
+		spt->locked_cnt--;
+	}
+	return true;
+}
+
+/* mlock 시스템 콜 : [ADDR, ADDR + LENGTH)의 페이지를 메모리에 올리고 고정한다.
+ * 구간에 매핑되지 않은 페이지가 있거나 vm_mlock_limit을 넘으면 false
+ * 도중에 실패하면 이번에 고정한 페이지를 모두 풀고 false */
+bool
+vm_mlock (void *addr, size_t length) {
+	struct supplemental_page_table *spt = &thread_current()->spt;
+	void *start = pg_round_down(addr);
+	void *end = pg_round_up(addr + length);
+	struct mlock_count cnt = {0, 0};
+
+	spt_tree_walk(spt, start, end, mlock_count_page, &cnt);
+	if (cnt.pages != (size_t) (end - start) / PGSIZE) {
+		return false;
+	}
+	if (spt->locked_cnt + cnt.unlocked > vm_mlock_limit) {
+		return false;
+	}
+
+	struct mlock_walk mw = { .spt = spt, .start = start };
+	mw.locked = bitmap_create(cnt.pages);
+	if (mw.locked == NULL) {
+		return false;
+	}
+	bool success = spt_tree_walk(spt, start, end, mlock_page, &mw);
+	if (!success) {
+		spt_tree_walk(spt, start, end, mlock_undo_page, &mw);
+	}
+	bitmap_destroy(mw.locked);
+	return success;
+}
+
+/* munlock 시스템 콜 : [ADDR, ADDR + LENGTH)의 페이지 고정을 푼다. */
+void
+vm_munlock (void *addr, size_t length) {
+	struct supplemental_page_table *spt = &thread_current()->spt;
+	spt_tree_walk(spt, pg_round_down(addr), pg_round_up(addr + length),
+			munlock_page, spt);
+}
+
+static bool
+range_occupied (struct page *page UNUSED, void *aux UNUSED) {
+	return false;
+}
+
+/* 페이지 정렬된 ADDR부터 PAGE_CNT개 페이지가 모두 사용자 영역 안에 있고
+ * 아직 아무 페이지도 매핑되지 않았으면 true */
+bool
+vm_range_free (void *addr, size_t page_cnt) {
+	uint8_t *start = addr;
+	//커널 주소면 아래 뺄셈이 넘쳐서 범위 검사를 통과하므로 먼저 막는다.
+	if (start == NULL || page_cnt == 0 || (uint64_t) start >= USER_STACK
+			|| page_cnt > ((uint64_t) USER_STACK - (uint64_t) start) / PGSIZE) {
+		return false;
+	}
+	return spt_tree_walk(&thread_current()->spt, start, start + page_cnt * PGSIZE,
+			range_occupied, NULL);
+}
+
+/* PAGE의 프레임을 evict 되지 않게 pin 하고 돌려준다. 프레임이 없으면 NULL.
+ * 다른 스레드가 pin 한 프레임(evict, fault 처리 중)은 풀릴 때까지 기다린다. */
+static struct frame *
+page_pin_frame (struct page *page) {
+	struct frame *frame = page_frame_settled(page);
+	if (frame != NULL && frame != &zero_frame) {
+		frame->pinned = true;
+	}
+	lock_release(&frame_table_lock);
+	return frame;
+}
+
+/* PAGE를 NEW_VA로 옮긴다. 새 자리의 SPT 슬롯과 페이지 테이블은
+ * spt_reserve로 미리 만들어 두어야 한다.
+ * 프레임과 swap 슬롯은 그대로 두고 PTE만 새 주소로 옮겨 걸어서
+ * 내용을 복사하지 않는다. */
+static void
+vm_move_page (struct supplemental_page_table *spt, struct page *page,
+		void *new_va) {
+	uint64_t *pml4 = thread_current()->pml4;
+	struct frame *frame = page_pin_frame(page);
+
+	//COW로 공유 중이면 읽기 전용으로 걸려 있으므로 기존 PTE의 쓰기 권한을 그대로 쓴다.
+	uint64_t *pte = pml4e_walk(pml4, (uint64_t) page->va, false);
+	bool mapped = frame != NULL && pte != NULL && (*pte & PTE_P);
+	bool rw = mapped && (*pte & PTE_W);
+	if (pte != NULL) {
+		pml4_clear_page(pml4, page->va);
+	}
+
+	spt_tree_remove(spt, page->va);
+	page->va = new_va;
+	if (!spt_tree_insert(spt, page)) {
+		NOT_REACHED();
+	}
+	if (mapped && !pml4_set_page(pml4, new_va, frame->kva, rw)) {
+		NOT_REACHED();
+	}
+	if (frame != NULL && frame != &zero_frame) {
+		vm_frame_unpin(frame);
+	}
+}
+
+/* NEW_BASE부터 CNT개의 SPT 슬롯과 페이지 테이블을 미리 만들어
+ * vm_move_page가 도중에 실패하지 않게 한다. 메모리가 부족하면 false */
+static bool
+spt_reserve (struct supplemental_page_table *spt, uint8_t *new_base,
+		size_t cnt) {
+	uint64_t *pml4 = thread_current()->pml4;
+	struct page probe;
+	for (size_t i = 0; i < cnt; i++) {
+		probe.va = new_base + i * PGSIZE;
+		if (!spt_tree_insert(spt, &probe)) {
+			return false;
+		}
+		spt_tree_remove(spt, probe.va);
+		if (pml4e_walk(pml4, (uint64_t) probe.va, 1) == NULL) {
+			return false;
+		}
+	}
+	return true;
+}
+
+/* mremap 시스템 콜 : ADDR에서 시작하는 anon 매핑(MAP_ANONYMOUS)의 크기를
+ * NEW_LENGTH로 바꾸고, NEW_ADDR가 NULL이 아니고 ADDR와 다르면 그 자리로 옮긴다.
+ * 페이지를 복사하지 않고 프레임과 swap 슬롯을 그대로 새 주소에 걸어 준다.
+ * 성공하면 매핑의 새 시작 주소, 실패하면 아무것도 바꾸지 않고 NULL */
+void *
+vm_mremap (void *addr, size_t old_length, size_t new_length, void *new_addr) {
+	struct supplemental_page_table *spt = &thread_current()->spt;
+	struct page *first = spt_find_page(spt, addr);
+	if (first == NULL || first->va != addr || first->mapped_page_count <= 0
+			|| page_get_type(first) != VM_ANON) {
+		return NULL;
+	}
+	size_t old_cnt = first->mapped_page_count;
+	size_t new_cnt = DIV_ROUND_UP(new_length, PGSIZE);
+	if (DIV_ROUND_UP(old_length, PGSIZE) != old_cnt || new_cnt == 0) {
+		return NULL;
+	}
+
+	uint8_t *old_base = addr;
+	uint8_t *new_base = new_addr != NULL ? new_addr : addr;
+	bool move = new_base != old_base;
+	bool writable = first->writable;
+	size_t keep = old_cnt < new_cnt ? old_cnt : new_cnt;
+
+	//옮길 자리(또는 제자리에서 늘어나는 부분)가 비어 있어야 한다.
+	if (move) {
+		if (!vm_range_free(new_base, new_cnt) || !spt_reserve(spt, new_base, keep)) {
+			return NULL;
+		}
+	} else if (new_cnt > old_cnt
+			&& !vm_range_free(old_base + old_cnt * PGSIZE, new_cnt - old_cnt)) {
+		return NULL;
+	}
+
+	//늘어나는 부분을 먼저 만들어서 실패하면 그대로 되돌릴 수 있게 한다.
+	for (size_t i = old_cnt; i < new_cnt; i++) {
+		if (!vm_alloc_page(VM_ANON, new_base + i * PGSIZE, writable)) {
+			while (i-- > old_cnt) {
+				spt_remove_page(spt, spt_find_page(spt, new_base + i * PGSIZE));
+			}
+			return NULL;
+		}
+	}
+
+	//줄어드는 부분은 해제한다.
+	for (size_t i = new_cnt; i < old_cnt; i++) {
+		spt_remove_page(spt, spt_tree_find(spt, old_base + i * PGSIZE));
+	}
+
+	if (move) {
+		spt->last_hit = NULL;
+		for (size_t i = 0; i < keep; i++) {
+			struct page *page = spt_tree_find(spt, old_base + i * PGSIZE);
+			if (page != NULL) {
+				vm_move_page(spt, page, new_base + i * PGSIZE);
+			}
+		}
+	}
+	first->mapped_page_count = new_cnt;
+	return new_base;
+}
+
+/* MAP_POPULATE : 아직 메모리에 없는 PAGE를 바로 올린다.
+ * MADV_WILLNEED와 달리 남는 프레임이 없으면 다른 페이지를 evict 한다. */
+static bool
+populate_page (struct page *page, void *aux UNUSED) {
+	if (page->frame != NULL || vm_map_file_frame(page)) {
+		return true;
+	}
+	struct frame *frame = anon_zero_page(page) ? vm_get_zeroed_frame() : vm_get_frame();
+	if (!vm_map_frame(page, frame)) {
+		return false;
+	}
+	populate_cnt++;
+	return true;
+}
+
+/* mmap(MAP_POPULATE) : [ADDR, ADDR + LENGTH)의 페이지를 주소 순서대로 모두
+ * 미리 올려서 나중에 fault가 나지 않게 한다. 파일 매핑은 파일을 앞에서부터
+ * 이어서 읽게 된다. 도중에 실패하면 나머지는 평소처럼 지연 로딩된다. */
+void
+vm_populate (void *addr, size_t length) {
+	spt_tree_walk(&thread_current()->spt, addr, pg_round_up(addr + length),
+			populate_page, NULL);
+}
+
+/* 파일 페이지 PAGE의 프레임을 매핑한 페이지 중 하나라도 바뀌었으면
+ * (fork나 공유로 여러 프로세스가 매핑할 수 있다) 모두의 dirty bit를 지우고
+ * 프레임 내용을 파일에 쓴다. 파일에 썼으면 true
+ * 쓰는 동안 evict 되거나 해제되지 않게 프레임을 pin 한다. */
+bool
+vm_file_writeback (struct page *page) {
+	struct frame *frame = page_pin_frame(page);
+	if (frame == NULL) { //evict 될 때 이미 파일에 썼다.
+		return false;
+	}
+	//writeback 데몬처럼 dirty bit를 먼저 지워서 쓰는 도중에 바뀐 내용은 다음에 다시 쓴다.
+	lock_acquire(&frame_table_lock);
+	bool dirty = frame_test_and_clear_dirty(frame);
+	lock_release(&frame_table_lock);
+	if (dirty) {
+		page->file.dirty_since = -1;
+		file_write_at(page->file.file, frame->kva, page->file.read_bytes,
+				page->file.offset);
+	}
+	vm_frame_unpin(frame);
+	return dirty;
+}
+
+/* msync : 파일 페이지 PAGE가 바뀌었으면 파일에 쓴다. 매핑은 그대로 둔다. */
+static bool
+msync_page (struct page *page, void *aux UNUSED) {
+	if (page->operations->type == VM_FILE && vm_file_writeback(page)) {
+		msync_cnt++;
+	}
+	return true;
+}
+
+/* msync 시스템 콜 : [ADDR, ADDR + LENGTH)에 매핑된 파일 페이지 중
+ * 바뀐 것만 파일에 쓴다. munmap과 달리 매핑을 해제하지 않는다. */
+void
+vm_msync (void *addr, size_t length) {
+	spt_tree_walk(&thread_current()->spt, pg_round_down(addr),
+			pg_round_up(addr + length), msync_page, NULL);
+}
+
+/* Handle the fault on write_protected page 
+ * COW로 공유 중인 페이지에 쓰려고 할 때 프레임을 복사해서 분리한다.
+ */
+static bool
+vm_handle_wp (struct page *page UNUSED) {
+	struct thread *curr = thread_current();
+	struct frame *old = page->frame;
+	if (old == NULL || !page->writable) { //원래 쓰기가 불가능한 페이지
+		return false;
+	}
+
+	//공유하던 다른 페이지들이 모두 떨어져 나갔으면 복사 없이 쓰기 권한만 돌려준다.
+	//(zero_frame은 share_cnt가 항상 2 이상이라 여기서는 복사한다.)
+	if (old->share_cnt == 1) {
+		return pml4_set_page(curr->pml4, page->va, old->kva, true);
+	}
+
+	//zero_frame에서 복사하는 대신 미리 0으로 채워 둔 프레임을 쓴다.
+	bool zero = old == &zero_frame;
+	struct frame *frame = zero ? vm_get_zeroed_frame() : vm_get_frame();
+	lock_acquire(&frame_table_lock);
+	if (page->frame != old) {
+		//프레임을 받는 동안 페이지가 swap out 되었으면 다시 fault가 나도록 둔다.
+		vm_free_frame(frame);
+		lock_release(&frame_table_lock);
+		return true;
+	}
+	if (!zero) {
+		memcpy(frame->kva, old->kva, PGSIZE);
+	}
+	frame_unlink(page);
+	frame_link(frame, page);
+	frame_unpin(frame);
+	lock_release(&frame_table_lock);
+
+	return pml4_set_page(curr->pml4, page->va, frame->kva, true);
+}
+
+/* fault가 난 PAGE를 올릴 때 어떤 종류의 fault인지 (faultstat 분류) */
+static enum fault_kind
+claim_fault_kind (struct page *page) {
+	switch (page->operations->type) {
+		case VM_UNINIT: {
+			//실행 파일의 데이터 페이지는 VM_ANON이 되지만 처음에는 파일에서 읽어 온다.
+			struct vm_entry *vme = lazy_file_entry(page);
+			return vme != NULL && vme->read_bytes > 0 ? FAULT_FILE : FAULT_ANON;
+		}
+		case VM_FILE:
+			return FAULT_FILE;
+		default:
+			//swap 슬롯이나 zswap 사본에서 읽어 오는 anon 페이지만 swap-in이다.
+			return page_needs_read(page) ? FAULT_SWAP : FAULT_ANON;
+	}
+}
+
+/* vm_try_handle_fault의 본체. 처리한 fault의 종류를 KIND에 저장한다. */
+static bool
+handle_fault (struct intr_frame *f, void *addr, bool user, bool write,
+		bool not_present, enum fault_kind *kind) {
+	struct supplemental_page_table *spt = &thread_current ()->spt;
+	struct page *page = NULL;
+
+	/* TODO: Validate the fault */
+	/* TODO: Your code goes here */
+	
+	// printf("vm_try_handle_fault | vm.c:209\n");
+	if (addr == NULL || is_kernel_vaddr(addr)) {
+		// printf("bad addr | vm.c:213");
+		return false;
+	}
+
+	if (not_present) { //접근하려는 페이지가 물리 메모리에 존재하지 않을 경우
+		// printf("not present ok | vm.c:218\n");
+		void *rsp = f->rsp;
+		if(!user) {
+			// printf("kernel access | vm.c:221\n");
+			rsp = thread_current()->rsp;
+		}
+		//USER_STACK - (1 << 20) = 스택 최대 크기 = 1MB
+		//x86-64 PUSH 명령어는 스택 포인터를 조정하기 전에 액세스 권한을 확인하므로 스택 포인터 아래 8바이트의 페이지 장애가 발생할 수 있다.
+		//SPT에 없는 스택 영역 주소일 때만 스택을 늘린다.
+		page = spt_find_page(spt, addr);
+		if (page == NULL && (USER_STACK - (1 << 20) <= rsp - 8 && rsp - 8 <= addr && addr <= USER_STACK)) {
+			// printf("vm_stack_growth  | vm.c:227\n");
+			vm_stack_growth(addr);
+			*kind = FAULT_STACK;
+			page = spt_find_page(spt, addr);
+		}
+		if(page == NULL) {
+			return false;
+		}
+		if (write && (!page->writable)) { //권한이 없는데 쓰려고 하는 경우
+			return false;
+		}
+		struct vm_rusage *ru = &thread_current()->rusage;
+		//쓴 적 없는 anon 페이지를 읽기만 하면 프레임을 할당하지 않는다.
+		if (*kind != FAULT_STACK) {
+			*kind = claim_fault_kind(page);
+		}
+		if (!write && zero_fill_page(page)) {
+			ru->minor_faults++;
+			return vm_map_zero_page(page);
+		}
+		//다른 프로세스가 이미 읽어 둔 파일 페이지는 프레임을 같이 쓴다.
+		if (vm_map_file_frame(page)) {
+			ru->minor_faults++;
+			return true;
+		}
+		if (page_needs_read(page)) {
+			ru->major_faults++;
+		} else {
+			ru->minor_faults++;
+		}
+		//claim 하면 uninit 페이지가 바뀌므로 미리 확인
+		struct vm_entry *vme = lazy_file_entry(page);
+		uint32_t slot = swapped_anon_slot(page);
+		//큰 anon 영역을 처음 쓰면 2MB 페이지로 한 번에 매핑한다.
+		if (write && zero_fill_page(page) && vm_map_huge(spt, page)) {
+			return true;
+		}
+		//스택처럼 내용 없이 시작하는 anon 페이지는 미리 0으로 채워 둔 프레임을 쓴다.
+		struct frame *frame = anon_zero_page(page) ? vm_get_zeroed_frame() : vm_get_frame();
+		if (!vm_map_frame(page, frame)) {
+			return false;
+		}
+		if (vme != NULL) {
+			file_fault_cnt++;
+			vm_fault_around(spt, page, vme);
+		} else if (slot != SWAP_SLOT_NONE) {
+			vm_swap_around(spt, page, slot);
+		}
+		return true;
+	}
+	// printf("present | vm.c:238\n");
+	if (write) { //읽기 전용으로 매핑된 페이지에 쓰려고 하는 경우 - COW
+		page = spt_find_page(spt, addr);
+		if (page != NULL) {
+			thread_current()->rusage.minor_faults++;
+			*kind = FAULT_WP;
+			return vm_handle_wp(page);
+		}
+	}
+	return false;
+}
+
+/* Return true on success */
+bool vm_try_handle_fault (struct intr_frame *f UNUSED, void *addr UNUSED, bool user UNUSED, bool write UNUSED, bool not_present UNUSED) {
+	//처리에 걸린 시간을 fault 종류별로 기록한다.
+	enum fault_kind kind = FAULT_ANON;
+	uint64_t start = rdtsc();
+	bool success = handle_fault(f, addr, user, write, not_present, &kind);
+	if (success) {
+		faultstat_record(kind, rdtsc() - start);
+	}
+	return success;
+}
+
+/* Free the page.
+ * DO NOT MODIFY THIS FUNCTION. */
+void
+vm_dealloc_page (struct page *page) {
+	//evict 중인 페이지는 swap_out이 끝난 뒤에 해제해야 한다.
+	//(희생자는 프레임만 pin 된 채로 락 없이 디스크에 쓰이고 그 뒤에 PAGE를 고친다.)
+	page_frame_settled(page);
+	lock_release(&frame_table_lock);
+	destroy (page);
+	free (page);
+}
+
+/* Claim the page that allocate on VA. */
+bool
+vm_claim_page (void *va UNUSED) {
+	struct page *page = NULL;
+	/* TODO: Fill this function */
+	page = spt_find_page(&thread_current()->spt, va);
+	if(page == NULL) {
+		return false;
+	}
+	return vm_do_claim_page (page);
+}
+
+/* Claim the PAGE and set up the mmu.
+ * vm_get_frame은 다른 프로세스가 쓰던 프레임을 그대로 줄 수 있으므로
+ * 내용 없이 시작하는 anon 페이지(스택, MAP_ANONYMOUS)는 0으로 채운 프레임을 쓴다. */
+static bool
+vm_do_claim_page (struct page *page) {
+	struct frame *frame = anon_zero_page (page) ? vm_get_zeroed_frame () : vm_get_frame ();
+	return vm_map_frame (page, frame);
+}
+
+/* PAGE를 FRAME에 올리고 MMU에 매핑한다. */
+static bool
+vm_map_frame (struct page *page, struct frame *frame) {
+	/* Set links */
+	vm_frame_link(frame, page);
+
+	/* TODO: Insert page table entry to map page's VA to frame's PA. */
+	bool result = pml4_set_page(thread_current()->pml4, page->va, frame->kva, page->writable)
+		&& swap_in (page, frame->kva);
+	if (result && page->operations->type == VM_FILE && !page->writable) {
+		file_frame_insert(frame, page);
+	}
+	//내용을 다 채운 뒤에야 evict 대상이 될 수 있다.
+	//실패해도 pin을 풀어야 페이지를 해제할 때 기다리지 않는다.
+	lock_acquire(&frame_table_lock);
+	frame_unpin(frame);
+	lock_release(&frame_table_lock);
+	return result;
+}
+
+/* Initialize new supplemental page table 
+ * 추가 페이지 테이블 초기화하는 함수
+ */
+void supplemental_page_table_init (struct supplemental_page_table *spt UNUSED) {
+	spt_tree_init(spt);
+	spt->last_hit = NULL;
+	spt->locked_cnt = 0;
+	spt->dying = false;
+}
+
+/* supplemental_page_table_copy에서 페이지 하나를 자식에게 복사한다. */
+static bool
+spt_copy_page_contents (struct page *src_page, void *src_) {
+	struct supplemental_page_table *src = src_;
+	struct supplemental_page_table *dst = &thread_current()->spt;
+	enum vm_type type = src_page->operations->type;
+	void *va = src_page->va;
+	bool writable = src_page->writable;
+
+	//부모의 실행 파일을 참조하는 페이지는 자식이 연 실행 파일을 참조하게 한다.
+	//vm_entry는 페이지마다 따로 갖도록 복사한다. (vm_map_file_frame에서 해제)
+	struct file *parent_exec = spt_owner(src)->running;
+	struct file *child_exec = thread_current()->running;
+
+	if(type == VM_UNINIT) { //초기화되지 않은 페이지인 경우
+		struct vm_entry *vme = lazy_file_entry(src_page);
+		if (vme != NULL) {
+			struct vm_entry *child_vme = malloc(sizeof *child_vme);
+			if (child_vme == NULL) {
+				return false;
+			}
+			*child_vme = *vme;
+			if (vme->f == parent_exec) {
+				child_vme->f = child_exec;
+			}
+			return vm_alloc_page_with_initializer(page_get_type(src_page), va, writable, lazy_load_segment, child_vme);
+		}
+		return vm_alloc_page_with_initializer(page_get_type(src_page), va, writable, src_page->uninit.init, src_page->uninit.aux);
+	}
+	else if(type == VM_FILE) { //파일 타입일 경우
+		struct vm_entry *vme = (struct vm_entry *)malloc(sizeof(struct vm_entry));
+		vme->f = src_page->file.file == parent_exec ? child_exec : src_page->file.file;
+		vme->offset = src_page->file.offset;
+		vme->read_bytes = src_page->file.read_bytes;
+		vme->zero_bytes = src_page->file.zero_bytes;
+
+		if(!vm_alloc_page_with_initializer(type, va,writable, NULL, vme)) {
+			return false;
+		}
+		struct page *page = spt_find_page(dst, va);
+		file_backed_initializer(page, type, NULL);
+		page->mapped_page_count = src_page->mapped_page_count;
+		//evict 중인 프레임에 연결하지 않도록 끝날 때까지 기다렸다가
+		//PTE를 거는 동안은 pin 해 둔다.
+		struct frame *frame = page_frame_settled(src_page);
+		if (frame != NULL) {
+			frame_link(frame, page);
+			frame->pinned = true;
+		}
+		lock_release(&frame_table_lock);
+		if (frame != NULL) {
+			bool ok = pml4_set_page(thread_current()->pml4, page->va, frame->kva, src_page->writable);
+			vm_frame_unpin(frame);
+			return ok;
+		}
+		return true;
+	}
+
+	//익명 페이지일 경우
+	if(!vm_alloc_page(type, va, writable)) {
+		return false;
+	}
+	struct page *dst_page = spt_find_page(dst, va);
+
+	//프레임을 복사하지 않고 부모와 자식 모두 읽기 전용으로 매핑해서 공유한다. (COW)
+	//첫 쓰기에서 vm_handle_wp가 프레임을 나눈다.
+	//kswapd가 부모 페이지를 내보내는 중이면 끝날 때까지 기다린 뒤 확인과 연결을
+	//한 번에 하고, PTE를 거는 동안은 evict 되지 않게 pin 해 둔다.
+	struct frame *frame = page_frame_settled(src_page);
+	if (frame != NULL) {
+		anon_initializer(dst_page, type, frame->kva);
+		frame_link(frame, dst_page);
+		if (frame != &zero_frame) {
+			frame->pinned = true;
+		}
+	}
+	lock_release(&frame_table_lock);
+	if(frame == NULL) {
+		//MADV_DONTNEED로 내용을 버린 페이지는 자식도 0에서 시작하는 페이지로 둔다.
+		if (src_page->anon.slot_num == SWAP_SLOT_NONE && src_page->anon.zswap == NULL) {
+			return true;
+		}
+		//swap out 된 페이지는 자식 프레임으로 바로 읽어온다.
+		return vm_claim_page(va) && anon_swap_copy(src_page, dst_page->frame->kva);
+	}
+	bool ok = pml4_set_page(spt_owner(src)->pml4, va, frame->kva, false)
+		&& pml4_set_page(thread_current()->pml4, va, frame->kva, false);
+	if (frame != &zero_frame) {
+		vm_frame_unpin(frame);
+	}
+	return ok;
+}
+
+/* 페이지를 복사하고 madvise 힌트도 물려준다. */
+static bool
+spt_copy_page (struct page *src_page, void *src) {
+	if (!spt_copy_page_contents(src_page, src)) {
+		return false;
+	}
+	spt_find_page(&thread_current()->spt, src_page->va)->advice = src_page->advice;
+	return true;
+}
+
+/* Copy supplemental page table from src to dst 
+ * 자식이 부모의 실행 컨텍스트를 상속해야 할 때 사용 - fork()
+ */
+bool
+supplemental_page_table_copy (struct supplemental_page_table *dst UNUSED, struct supplemental_page_table *src UNUSED) {
+	//가상 주소 순서대로 부모의 모든 페이지를 복사
+	return spt_tree_walk(src, NULL, (void *) KERN_BASE, spt_copy_page, src);
+}
+
+/* supplemental_page_table_kill에서 한 번에 모아서 처리하는 단위 */
+#define TEARDOWN_BATCH 64
+
+/* supplemental_page_table_kill의 진행 상태
+ * anon 페이지는 frame_table_lock을 한 번 잡은 채로 여러 개를 정리하고,
+ * swap 슬롯은 모아 두었다가 한꺼번에 돌려준다. */
+struct spt_teardown {
+	bool locked;				/* frame_table_lock을 잡고 있는지 */
+	size_t locked_pages;		/* 락을 잡은 뒤 정리한 페이지 수 */
+	uint32_t slots[TEARDOWN_BATCH];	/* 돌려줄 swap 슬롯 */
+	size_t slot_cnt;
+};
+
+/* 잡고 있던 frame_table_lock을 놓고 모아 둔 swap 슬롯을 돌려준다. */
+static void
+teardown_flush (struct spt_teardown *td) {
+	if (td->locked) {
+		lock_release(&frame_table_lock);
+		td->locked = false;
+	}
+	anon_swap_slots_free(td->slots, td->slot_cnt);
+	td->slot_cnt = 0;
+}
+
+/* supplemental_page_table_kill에서 페이지 하나를 제거한다.
+ * anon 페이지와 쓸 수 없는 파일 페이지(코드)는 PTE를 하나씩 지우지 않는다.
+ * 페이지 테이블은 process_cleanup에서 pml4_destroy_tables로 통째로 버린다.
+ * 파일에 다시 써야 할 수 있는 나머지 페이지는 destroy로 정리한다. */
+static bool
+spt_destroy_page (struct page *page, void *aux) {
+	struct spt_teardown *td = aux;
+	enum vm_type type = page->operations->type;
+	if (type != VM_ANON && (type != VM_FILE || page->writable)) {
+		teardown_flush(td);
+		vm_dealloc_page(page);
+		return true;
+	}
+
+	if (page->frame != NULL) {
+		if (!td->locked) {
+			lock_acquire(&frame_table_lock);
+			td->locked = true;
+			td->locked_pages = 0;
+		}
+		if (page->frame != NULL && page->frame->pinned) {
+			//evict 중이면 락을 놓고 swap_out이 PAGE를 다 쓸 때까지 기다린다.
+			teardown_flush(td);
+			page_frame_settled(page);
+			td->locked = true;
+			td->locked_pages = 0;
+		}
+	}
+	struct frame *frame = page->frame;
+	if (frame != NULL) {
+		frame_unlink(page);
+		//pin 한 쪽이 아직 사용 중이면 해제는 그쪽에 맡긴다. (vm_frame_unpin)
+		if (frame->share_cnt == 0 && !frame->pinned) {
+			vm_free_frame(frame);
+		}
+		if (++td->locked_pages == TEARDOWN_BATCH) {
+			//다른 스레드가 너무 오래 기다리지 않도록 가끔 락을 놓는다.
+			teardown_flush(td);
+		}
+	}
+	if (type == VM_FILE) {
+		free(page);
+		return true;
+	}
+	if (page->anon.slot_num != SWAP_SLOT_NONE) {
+		td->slots[td->slot_cnt++] = page->anon.slot_num;
+		if (td->slot_cnt == TEARDOWN_BATCH) {
+			teardown_flush(td);
+		}
+	}
+	if (page->anon.zswap != NULL) {
+		zswap_free(page->anon.zswap);
+	}
+	free(page);
+	return true;
+}
+
+/* Free the resource hold by the supplemental page table 
+ * process_exit() : 프로세스 종료시 호출
+ */
+void
+supplemental_page_table_kill (struct supplemental_page_table *spt UNUSED) {
+	/* TODO: Destroy all the supplemental_page_table hold by thread and
+	 * TODO: writeback all the modified contents to the storage. */
+	struct spt_teardown td = { .locked = false, .slot_cnt = 0 };
+	spt->last_hit = NULL;
+	spt->locked_cnt = 0;
+	//kswapd가 vm_get_swap_cluster에서 이 SPT를 보지 않게 한다.
+	lock_acquire(&frame_table_lock);
+	spt->dying = true;
+	lock_release(&frame_table_lock);
+	spt_tree_destroy(spt, spt_destroy_page, &td);
+	teardown_flush(&td);
+	//exec는 빈 SPT를 계속 쓴다.
+	lock_acquire(&frame_table_lock);
+	spt->dying = false;
+	lock_release(&frame_table_lock);
+}
@@ -0,0 +1,196 @@
+/* zswap.c: Compressed in-memory tier in front of the swap disk.
+ *
+ * An evicted anonymous page is first compressed with a small LZ77
+ * compressor.  If it shrinks to at most a quarter page and the pool has
+ * room, the compressed copy is kept in kernel memory and the page
+ * never reaches the disk.  Otherwise the caller writes it to a swap
+ * slot as usual.
+ *
+ * The compressed stream is a sequence of groups.  Each group starts
+ * with a control byte whose bits, from the least significant, tell
+ * whether each of the next eight items is a literal byte (0) or a
+ * match (1).  A match is two bytes: the low 8 bits of the distance,
+ * then the high 4 bits of the distance and a 4-bit length code.  A
+ * length code of 15 is followed by one more byte that extends it. */
+
+#include "vm/zswap.h"
+#include <debug.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include "threads/malloc.h"
+#include "threads/synch.h"
+#include "threads/vaddr.h"
+
+#define LZ_HASH_BITS 12
+#define LZ_MIN_MATCH 3
+#define LZ_MAX_MATCH (LZ_MIN_MATCH + 15 + 255)
+#define LZ_MAX_DIST 4095
+
+/* A compressed page. */
+struct zswap_blob {
+	uint16_t size;              /* Bytes used in DATA. */
+	uint8_t data[];
+};
+
+/* Largest compressed size worth keeping, chosen so that a blob fits
+   in the largest malloc() block size, 1 kB.  Anything bigger would be
+   served from whole pages of the kernel pool and save nothing. */
+#define ZSWAP_MAX_BLOCK 1024
+#define ZSWAP_MAX_SIZE (ZSWAP_MAX_BLOCK - sizeof (struct zswap_blob))
+
+size_t zswap_max_pages = 128;
+
+static struct lock zswap_lock;
+static size_t zswap_used;       /* Bytes of compressed data stored. */
+
+/* Compression state, protected by zswap_lock. */
+static uint16_t lz_table[1 << LZ_HASH_BITS];
+static uint8_t lz_buf[ZSWAP_MAX_SIZE];
+
+/* Statistics. */
+static long long store_cnt;     /* Pages stored. */
+static long long reject_cnt;    /* Pages that did not compress well. */
+static long long full_cnt;      /* Pages turned away by a full pool. */
+static long long load_cnt;      /* Pages loaded back. */
+
+void
+zswap_init (void) {
+	lock_init (&zswap_lock);
+	zswap_used = 0;
+}
+
+static inline unsigned
+lz_hash (const uint8_t *p) {
+	uint32_t v = p[0] | p[1] << 8 | p[2] << 16;
+	return (v * 2654435761u) >> (32 - LZ_HASH_BITS);
+}
+
+/* Compresses the page at SRC into DST.  Returns the compressed
+   size, or 0 if it would exceed LIMIT bytes. */
+static size_t
+lz_compress (const uint8_t *src, uint8_t *dst, size_t limit) {
+	size_t ip = 0, op = 0, ctrl = 0;
+	int bit = 8;
+
+	memset (lz_table, 0, sizeof lz_table);
+	while (ip < PGSIZE) {
+		if (bit == 8) {
+			if (op >= limit)
+				return 0;
+			ctrl = op++;
+			dst[ctrl] = 0;
+			bit = 0;
+		}
+
+		size_t len = 0, dist = 0;
+		if (ip + LZ_MIN_MATCH <= PGSIZE) {
+			unsigned h = lz_hash (src + ip);
+			size_t cand = lz_table[h];
+			lz_table[h] = ip;
+			dist = ip - cand;
+			if (cand < ip && dist <= LZ_MAX_DIST) {
+				size_t max = PGSIZE - ip < LZ_MAX_MATCH ? PGSIZE - ip : LZ_MAX_MATCH;
+				while (len < max && src[cand + len] == src[ip + len])
+					len++;
+			}
+		}
+
+		if (len >= LZ_MIN_MATCH) {
+			size_t code = len - LZ_MIN_MATCH;
+			if (op + (code < 15 ? 2 : 3) > limit)
+				return 0;
+			dst[ctrl] |= 1 << bit;
+			dst[op++] = dist & 0xff;
+			dst[op++] = (dist >> 8) << 4 | (code < 15 ? code : 15);
+			if (code >= 15)
+				dst[op++] = code - 15;
+			ip += len;
+		} else {
+			if (op + 1 > limit)
+				return 0;
+			dst[op++] = src[ip++];
+		}
+		bit++;
+	}
+	return op;
+}
+
+/* Decompresses SIZE bytes at SRC into the page at DST. */
+static void
+lz_decompress (const uint8_t *src, size_t size, uint8_t *dst) {
+	size_t ip = 0, op = 0;
+
+	while (op < PGSIZE) {
+		ASSERT (ip < size);
+		uint8_t ctrl = src[ip++];
+		for (int bit = 0; bit < 8 && op < PGSIZE; bit++) {
+			if (ctrl & (1 << bit)) {
+				size_t dist = src[ip] | (src[ip + 1] >> 4) << 8;
+				size_t len = src[ip + 1] & 15;
+				ip += 2;
+				if (len == 15)
+					len += src[ip++];
+				len += LZ_MIN_MATCH;
+				ASSERT (dist > 0 && dist <= op && op + len <= PGSIZE);
+				for (; len > 0; len--, op++)
+					dst[op] = dst[op - dist];
+			} else
+				dst[op++] = src[ip++];
+		}
+	}
+}
+
+/* Compresses the page at KVA and keeps the result in memory.
+   Returns a handle for zswap_load() and zswap_free(), or a null
+   pointer if the page does not compress well enough or the pool
+   is full, in which case the caller must write it to disk. */
+void *
+zswap_store (const void *kva) {
+	struct zswap_blob *blob = NULL;
+
+	if (zswap_max_pages == 0)
+		return NULL;
+
+	lock_acquire (&zswap_lock);
+	size_t size = lz_compress (kva, lz_buf, ZSWAP_MAX_SIZE);
+	if (size == 0)
+		reject_cnt++;
+	else if (zswap_used + size > zswap_max_pages * PGSIZE)
+		full_cnt++;
+	else if ((blob = malloc (sizeof *blob + size)) != NULL) {
+		blob->size = size;
+		memcpy (blob->data, lz_buf, size);
+		zswap_used += size;
+		store_cnt++;
+	}
+	lock_release (&zswap_lock);
+	return blob;
+}
+
+/* Decompresses the page stored under HANDLE into KVA.  The stored
+   copy is kept. */
+void
+zswap_load (const void *handle, void *kva) {
+	const struct zswap_blob *blob = handle;
+	lz_decompress (blob->data, blob->size, kva);
+	load_cnt++;
+}
+
+/* Frees the page stored under HANDLE. */
+void
+zswap_free (void *handle) {
+	struct zswap_blob *blob = handle;
+
+	lock_acquire (&zswap_lock);
+	zswap_used -= blob->size;
+	lock_release (&zswap_lock);
+	free (blob);
+}
+
+void
+zswap_print_stats (void) {
+	printf ("Zswap: %lld stored, %lld loaded, %lld incompressible, "
+			"%lld pool full, %zu bytes in use\n",
+			store_cnt, load_cnt, reject_cnt, full_cnt, zswap_used);
+}